@@ -0,0 +1,438 @@
+// include/adc_capture.h
+#ifndef ADC_CAPTURE_H
+#define ADC_CAPTURE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+#include <math.h>
+#include <vector>
+#include "sample_ring.h"
+
+#if defined(ESP32) && __has_include(<driver/i2s.h>)
+  #include <driver/i2s.h>
+  #include <soc/soc_caps.h>
+  #if SOC_I2S_SUPPORTS_ADC
+    #define ADC_CAPTURE_HAS_I2S 1
+  #endif
+  #if __has_include(<esp_camera.h>)
+    #include <esp_camera.h>
+    #define ADC_CAPTURE_CHECK_CAMERA 1
+  #endif
+#endif
+
+#ifndef ARDUINO
+  #include <thread>
+#endif
+
+#define ADC_RING_SAMPLES 8192           // 采样环形缓冲（2 的幂，int16）
+#define ADC_CAPTURE_CHUNK 256           // 采集任务每次读取的样本数
+#define ADC_DMA_BUF_COUNT 4
+#define ADC_DMA_BUF_LEN 256
+#define ADC_SYNTH_MAX_TONES 4
+
+// ========================
+// 采样源接口
+// read() 在 timeoutMs 内返回已采集的样本（有符号、以 0 为中心）
+// ========================
+class SampleSource {
+public:
+  virtual ~SampleSource() {}
+  virtual const char* name() = 0;
+  virtual bool begin(uint32_t sampleRateHz) = 0;
+  virtual size_t read(int16_t* out, size_t maxSamples, uint32_t timeoutMs) = 0;
+  virtual void end() = 0;
+};
+
+// ========================
+// ESP32 内置 ADC 经 I2S DMA 采样
+// I2S 外设按采样率驱动 ADC1，DMA 写入描述符缓冲，CPU 只在缓冲满时搬运
+//
+// 注意：ESP32 只有 I2S0 支持内置 ADC 模式，而 esp32-camera 也使用 I2S0 接收像素数据，
+// 两者不能同时使用。摄像头已初始化时 begin() 拒绝启动；采集期间也不要初始化摄像头
+// ========================
+#ifdef ADC_CAPTURE_HAS_I2S
+class I2sAdcSource : public SampleSource {
+private:
+  i2s_port_t port;
+  adc1_channel_t channel;
+  bool started;
+
+public:
+  I2sAdcSource(adc1_channel_t adcChannel, i2s_port_t i2sPort = I2S_NUM_0)
+    : port(i2sPort), channel(adcChannel), started(false) {}
+
+  const char* name() override { return "i2s-adc"; }
+
+  bool begin(uint32_t sampleRateHz) override {
+    #ifdef ADC_CAPTURE_CHECK_CAMERA
+      if (esp_camera_sensor_get() != nullptr) {
+        Serial.println("✗ I2S0 is in use by the camera, ADC capture not started");
+        return false;
+      }
+    #endif
+
+    i2s_config_t cfg = {};
+    cfg.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN);
+    cfg.sample_rate = sampleRateHz;
+    cfg.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    cfg.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    cfg.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    cfg.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+    cfg.dma_buf_count = ADC_DMA_BUF_COUNT;
+    cfg.dma_buf_len = ADC_DMA_BUF_LEN;
+    cfg.use_apll = false;
+
+    if (i2s_driver_install(port, &cfg, 0, nullptr) != ESP_OK) {
+      Serial.println("✗ I2S driver install failed");
+      return false;
+    }
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    adc1_config_channel_atten(channel, ADC_ATTEN_DB_11);
+    i2s_set_adc_mode(ADC_UNIT_1, channel);
+    i2s_adc_enable(port);
+    started = true;
+    return true;
+  }
+
+  size_t read(int16_t* out, size_t maxSamples, uint32_t timeoutMs) override {
+    size_t bytesRead = 0;
+    i2s_read(port, out, maxSamples * sizeof(int16_t), &bytesRead, pdMS_TO_TICKS(timeoutMs));
+    size_t n = bytesRead / sizeof(int16_t);
+
+    // 高 4 位是通道号；ESP32 的 I2S ADC 模式中相邻样本顺序互换
+    for (size_t i = 0; i + 1 < n; i += 2) {
+      int16_t a = out[i];
+      out[i] = (int16_t)((out[i + 1] & 0x0FFF) - 2048);
+      out[i + 1] = (int16_t)((a & 0x0FFF) - 2048);
+    }
+    if (n & 1) {
+      out[n - 1] = (int16_t)((out[n - 1] & 0x0FFF) - 2048);
+    }
+    return n;
+  }
+
+  void end() override {
+    if (!started) return;
+    i2s_adc_disable(port);
+    i2s_driver_uninstall(port);
+    started = false;
+  }
+};
+#endif
+
+// ========================
+// 合成波形源（主机测试 / 吞吐基准）
+// 若干正弦分量 + 白噪声，可按实时速率节拍或不限速产生
+// ========================
+struct SynthTone {
+  float frequencyHz;
+  float amplitude;                // 满量程 2047
+};
+
+class SyntheticSource : public SampleSource {
+private:
+  SynthTone tones[ADC_SYNTH_MAX_TONES];
+  float phases[ADC_SYNTH_MAX_TONES];
+  uint8_t toneCount;
+  float noiseAmplitude;
+  uint32_t rng;
+  uint32_t sampleRate;
+  bool paced;                     // true：按实时采样率产生
+  uint32_t lastUs;
+  uint64_t elapsedUs;             // 64 位累计，micros() 约 71.6 分钟回绕一次
+  uint64_t generated;
+
+public:
+  SyntheticSource(bool realTime = true) {
+    toneCount = 0;
+    noiseAmplitude = 0;
+    rng = 0x1234567;
+    sampleRate = 1000;
+    paced = realTime;
+    lastUs = 0;
+    elapsedUs = 0;
+    generated = 0;
+  }
+
+  const char* name() override { return "synthetic"; }
+
+  bool addTone(float frequencyHz, float amplitude) {
+    if (toneCount >= ADC_SYNTH_MAX_TONES) return false;
+    tones[toneCount] = {frequencyHz, amplitude};
+    phases[toneCount] = 0;
+    toneCount++;
+    return true;
+  }
+
+  void setNoise(float amplitude, uint32_t seed = 0x1234567) {
+    noiseAmplitude = amplitude;
+    rng = seed ? seed : 0x1234567;
+  }
+
+  bool begin(uint32_t sampleRateHz) override {
+    sampleRate = sampleRateHz > 0 ? sampleRateHz : 1;
+    lastUs = micros();
+    elapsedUs = 0;
+    generated = 0;
+    return true;
+  }
+
+  size_t read(int16_t* out, size_t maxSamples, uint32_t timeoutMs) override {
+    size_t n = maxSamples;
+    if (paced) {
+      uint32_t now = micros();
+      elapsedUs += (uint32_t)(now - lastUs);
+      lastUs = now;
+      uint64_t due = elapsedUs * sampleRate / 1000000ULL;
+      if (due <= generated) {
+        delay(timeoutMs > 0 ? 1 : 0);
+        return 0;
+      }
+      if (due - generated < n) n = (size_t)(due - generated);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+      float v = 0;
+      for (uint8_t t = 0; t < toneCount; t++) {
+        v += tones[t].amplitude * sinf(phases[t]);
+        phases[t] += 2.0f * (float)M_PI * tones[t].frequencyHz / sampleRate;
+        if (phases[t] > 2.0f * (float)M_PI) phases[t] -= 2.0f * (float)M_PI;
+      }
+      if (noiseAmplitude > 0) {
+        v += noiseAmplitude * ((float)(nextRandom() & 0xFFFF) / 32768.0f - 1.0f);
+      }
+      if (v > 2047) v = 2047;
+      if (v < -2048) v = -2048;
+      out[i] = (int16_t)lrintf(v);
+    }
+    generated += n;
+    return n;
+  }
+
+  void end() override {}
+
+private:
+  uint32_t nextRandom() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+  }
+};
+
+// ========================
+// 采集统计
+// ========================
+struct AdcCaptureStats {
+  uint32_t captured;              // 已写入环形缓冲的样本数
+  uint32_t overruns;              // 消费者跟不上而丢弃的样本数
+  uint32_t blocks;                // 已交付的样本块数
+  float effectiveRateHz;          // 实际采样率
+};
+
+typedef std::function<void(const int16_t* samples, size_t count, uint32_t firstIndex)> AdcBlockHandler;
+
+// ========================
+// 高速采样管线
+// 采集任务：SampleSource -> 无锁环形缓冲；
+// 消费者（loop 或处理任务）：poll() 按固定块大小取出并回调
+// ========================
+class AdcCapture {
+private:
+  SampleSource& source;
+  SampleRing<int16_t, ADC_RING_SAMPLES> ring;
+  std::atomic<bool> running;
+  std::atomic<bool> taskDone;
+  std::atomic<uint32_t> captured;
+  uint32_t sampleRate;
+  uint32_t startMs;
+  uint32_t blocks;
+  uint32_t consumed;              // 已交付给处理的样本序号
+  size_t blockSize;
+  std::vector<int16_t> block;
+  AdcBlockHandler handler;
+  #ifdef ARDUINO
+    TaskHandle_t task;
+  #else
+    std::thread worker;
+  #endif
+
+public:
+  AdcCapture(SampleSource& sampleSource) : source(sampleSource) {
+    running = false;
+    taskDone = true;
+    captured = 0;
+    sampleRate = 0;
+    startMs = 0;
+    blocks = 0;
+    consumed = 0;
+    blockSize = 0;
+    #ifdef ARDUINO
+      task = nullptr;
+    #endif
+  }
+
+  ~AdcCapture() {
+    stop();
+  }
+
+  // ========================
+  // 启动采集任务（ESP32 上固定在 core 0，与 loop 所在的 core 1 分开）
+  // ========================
+  bool start(uint32_t sampleRateHz, uint8_t taskPriority = 5) {
+    if (running) return true;
+    if (!source.begin(sampleRateHz)) {
+      return false;
+    }
+    sampleRate = sampleRateHz;
+    startMs = millis();
+    captured = 0;
+    running = true;
+    taskDone = false;
+
+    #ifdef ARDUINO
+      if (xTaskCreatePinnedToCore(captureTask, "adc_capture", 4096, this, taskPriority, &task, 0) != pdPASS) {
+        running = false;
+        taskDone = true;
+        source.end();
+        Serial.println("✗ ADC capture task create failed");
+        return false;
+      }
+    #else
+      (void)taskPriority;
+      worker = std::thread(captureTask, this);
+    #endif
+
+    Serial.printf("✓ ADC capture started: %s @ %u Hz\n", source.name(), (unsigned)sampleRateHz);
+    return true;
+  }
+
+  void stop() {
+    if (!running) return;
+    running = false;
+    #ifdef ARDUINO
+      while (!taskDone) delay(1);
+      task = nullptr;
+    #else
+      if (worker.joinable()) worker.join();
+    #endif
+    source.end();
+  }
+
+  bool isRunning() {
+    return running;
+  }
+
+  // ========================
+  // 设置块回调（由 poll() 在调用者任务中执行）
+  // ========================
+  void setBlockHandler(size_t samplesPerBlock, AdcBlockHandler blockHandler) {
+    blockSize = samplesPerBlock;
+    block.assign(samplesPerBlock, 0);
+    handler = blockHandler;
+  }
+
+  // ========================
+  // 交付所有完整的样本块，返回交付的块数
+  // ========================
+  size_t poll() {
+    if (!handler || blockSize == 0) return 0;
+    size_t delivered = 0;
+    while (ring.available() >= blockSize) {
+      ring.read(block.data(), blockSize);
+      handler(block.data(), blockSize, consumed);
+      consumed += blockSize;
+      blocks++;
+      delivered++;
+    }
+    return delivered;
+  }
+
+  // 直接读取（不使用块回调时）
+  size_t read(int16_t* out, size_t maxSamples) {
+    size_t n = ring.read(out, maxSamples);
+    consumed += n;
+    return n;
+  }
+
+  size_t available() {
+    return ring.available();
+  }
+
+  uint32_t getSampleRate() {
+    return sampleRate;
+  }
+
+  AdcCaptureStats getStats() {
+    AdcCaptureStats stats;
+    stats.captured = captured;
+    stats.overruns = ring.overrunCount();
+    stats.blocks = blocks;
+    uint32_t elapsed = millis() - startMs;
+    stats.effectiveRateHz = elapsed > 0 ? (captured + stats.overruns) * 1000.0f / elapsed : 0;
+    return stats;
+  }
+
+private:
+  static void captureTask(void* arg) {
+    AdcCapture* self = static_cast<AdcCapture*>(arg);
+    int16_t chunk[ADC_CAPTURE_CHUNK];
+
+    while (self->running) {
+      size_t n = self->source.read(chunk, ADC_CAPTURE_CHUNK, 20);
+      if (n > 0) {
+        self->captured += self->ring.write(chunk, n);
+      }
+    }
+
+    self->taskDone = true;
+    #ifdef ARDUINO
+      vTaskDelete(nullptr);
+    #endif
+  }
+};
+
+// ========================
+// 管线吞吐基准
+// 用不限速的合成源驱动完整管线（采集任务 -> 环形缓冲 -> poll() 块回调），
+// 消费者不间断轮询；delivered 是管线能持续交付的样本速率上限，
+// 实际采样率应明显低于该值，overruns 表示消费者跟不上时丢弃的样本
+// ========================
+struct AdcThroughput {
+  float producedPerSec;           // 采集任务写入环形缓冲的速率
+  float deliveredPerSec;          // 交付给块回调的速率
+  uint32_t overruns;
+};
+
+inline AdcThroughput measureAdcThroughput(uint32_t durationMs = 1000, size_t blockSize = 512) {
+  AdcThroughput result = {0, 0, 0};
+  SyntheticSource source(false);
+  source.addTone(1000, 1000);
+  source.setNoise(50);
+
+  uint64_t delivered = 0;
+  AdcCapture capture(source);
+  capture.setBlockHandler(blockSize, [&delivered](const int16_t* samples, size_t count, uint32_t firstIndex) {
+    delivered += count;
+  });
+  if (!capture.start(1000000)) return result;
+
+  uint32_t start = millis();
+  while (millis() - start < durationMs) {
+    if (capture.poll() == 0) delay(0);
+  }
+  uint32_t elapsed = millis() - start;
+  capture.stop();
+
+  AdcCaptureStats stats = capture.getStats();
+  if (elapsed == 0) elapsed = 1;
+  result.producedPerSec = (stats.captured + stats.overruns) * 1000.0f / elapsed;
+  result.deliveredPerSec = delivered * 1000.0f / elapsed;
+  result.overruns = stats.overruns;
+  Serial.printf("ADC pipeline: produced %.0f/s, delivered %.0f/s, overruns %u\n",
+                result.producedPerSec, result.deliveredPerSec, (unsigned)result.overruns);
+  return result;
+}
+
+#endif
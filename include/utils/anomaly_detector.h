@@ -0,0 +1,312 @@
+// include/anomaly_detector.h
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include <Arduino.h>
+#include <math.h>
+#include <vector>
+#include "spectral_features.h"
+
+#ifndef ARDUINO
+  #include <stdio.h>
+  #include <stdlib.h>
+#endif
+
+#define ANOMALY_MAX_FEATURES (SPECTRUM_MAX_BANDS + 2)
+
+// ========================
+// 特征向量
+// ========================
+struct FeatureVector {
+  float values[ANOMALY_MAX_FEATURES];
+  uint8_t count;
+};
+
+// 由频谱特征构造：log(1 + rms) 和各频带 log(1 + rms)，压缩动态范围
+inline FeatureVector featuresFromSpectrum(const SpectralFeatures& f) {
+  FeatureVector v;
+  v.count = 0;
+  v.values[v.count++] = log1pf(f.rms);
+  for (uint8_t i = 0; i < f.bandCount && v.count < ANOMALY_MAX_FEATURES; i++) {
+    v.values[v.count++] = log1pf(f.bandRms[i]);
+  }
+  return v;
+}
+
+// ========================
+// 单个窗口的检测结果
+// ========================
+struct AnomalyResult {
+  float score;                    // 各特征 |z| 的均方根
+  float maxZ;                     // 最大 |z|
+  uint8_t worstFeature;           // 偏离最大的特征
+  bool learning;                  // 仍在学习基线
+  bool anomalous;                 // 当前处于异常状态
+  bool changed;                   // 本窗口状态发生变化（进入 / 退出异常）
+  uint32_t inferenceUs;
+};
+
+// ========================
+// 流式异常检测
+// 学习阶段用 Welford 算法估计每个特征的均值和方差；
+// 之后按 z 分数打分，只用正常窗口以 EWMA 缓慢跟踪基线漂移。
+// 进入异常需连续 triggerWindows 个窗口超过阈值，退出使用更低的阈值（滞回）
+// ========================
+class AnomalyDetector {
+private:
+  float mean[ANOMALY_MAX_FEATURES];
+  float variance[ANOMALY_MAX_FEATURES];
+  uint8_t featureCount;
+  uint32_t samples;               // 已学习的窗口数
+  uint32_t learningWindows;
+  float alpha;                    // EWMA 系数
+  float enterThreshold;
+  float exitThreshold;
+  uint8_t triggerWindows;
+  uint8_t aboveCount;
+  bool anomalous;
+
+  // 推理耗时统计
+  uint32_t inferences;
+  uint32_t lastUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+
+public:
+  AnomalyDetector() {
+    learningWindows = 50;
+    alpha = 0.01f;
+    enterThreshold = 4.0f;
+    exitThreshold = 2.5f;
+    triggerWindows = 2;
+    reset();
+  }
+
+  void reset() {
+    memset(mean, 0, sizeof(mean));
+    memset(variance, 0, sizeof(variance));
+    featureCount = 0;
+    samples = 0;
+    aboveCount = 0;
+    anomalous = false;
+    inferences = 0;
+    lastUs = 0;
+    maxUs = 0;
+    totalUs = 0;
+  }
+
+  // ========================
+  // 配置
+  // ========================
+  void setLearningWindows(uint32_t windows) {
+    learningWindows = windows > 2 ? windows : 2;
+  }
+
+  void setThresholds(float enterScore, float exitScore, uint8_t consecutiveWindows = 2) {
+    enterThreshold = enterScore;
+    exitThreshold = exitScore < enterScore ? exitScore : enterScore;
+    triggerWindows = consecutiveWindows > 0 ? consecutiveWindows : 1;
+  }
+
+  void setAdaptation(float ewmaAlpha) {
+    alpha = ewmaAlpha;
+  }
+
+  bool isLearning() {
+    return samples < learningWindows;
+  }
+
+  bool isAnomalous() {
+    return anomalous;
+  }
+
+  // ========================
+  // 处理一个特征向量
+  // ========================
+  AnomalyResult process(const FeatureVector& v) {
+    uint32_t start = micros();
+    AnomalyResult r;
+    r.score = 0;
+    r.maxZ = 0;
+    r.worstFeature = 0;
+    r.changed = false;
+
+    if (featureCount == 0) featureCount = v.count;
+    uint8_t n = v.count < featureCount ? v.count : featureCount;
+
+    r.learning = isLearning();
+    if (r.learning) {
+      learn(v, n);
+    } else {
+      float sumSq = 0;
+      for (uint8_t i = 0; i < n; i++) {
+        // 方差下限，避免完全平稳的特征产生无穷大的 z
+        float sd = sqrtf(variance[i] + 1e-6f);
+        float z = fabsf(v.values[i] - mean[i]) / sd;
+        sumSq += z * z;
+        if (z > r.maxZ) {
+          r.maxZ = z;
+          r.worstFeature = i;
+        }
+      }
+      r.score = n > 0 ? sqrtf(sumSq / n) : 0;
+      r.changed = updateState(r.maxZ);
+
+      if (!anomalous) {
+        adapt(v, n);
+      }
+    }
+    r.anomalous = anomalous;
+
+    r.inferenceUs = micros() - start;
+    recordTiming(r.inferenceUs);
+    return r;
+  }
+
+  AnomalyResult process(const SpectralFeatures& f) {
+    return process(featuresFromSpectrum(f));
+  }
+
+  // ========================
+  // 推理耗时
+  // ========================
+  uint32_t getLastInferenceUs() { return lastUs; }
+  uint32_t getMaxInferenceUs() { return maxUs; }
+  float getMeanInferenceUs() { return inferences ? (float)totalUs / inferences : 0; }
+
+private:
+  void learn(const FeatureVector& v, uint8_t n) {
+    samples++;
+    for (uint8_t i = 0; i < n; i++) {
+      // Welford：variance 暂存 M2，学习结束时换算为方差
+      float delta = v.values[i] - mean[i];
+      mean[i] += delta / samples;
+      variance[i] += delta * (v.values[i] - mean[i]);
+    }
+    if (samples == learningWindows) {
+      for (uint8_t i = 0; i < n; i++) variance[i] /= (samples - 1);
+    }
+  }
+
+  void adapt(const FeatureVector& v, uint8_t n) {
+    for (uint8_t i = 0; i < n; i++) {
+      float delta = v.values[i] - mean[i];
+      mean[i] += alpha * delta;
+      variance[i] = (1 - alpha) * (variance[i] + alpha * delta * delta);
+    }
+  }
+
+  // 进入异常看最大 z（单个频带突变即可触发），返回状态是否变化
+  bool updateState(float maxZ) {
+    if (!anomalous) {
+      aboveCount = maxZ > enterThreshold ? aboveCount + 1 : 0;
+      if (aboveCount >= triggerWindows) {
+        anomalous = true;
+        aboveCount = 0;
+        return true;
+      }
+    } else if (maxZ < exitThreshold) {
+      anomalous = false;
+      return true;
+    }
+    return false;
+  }
+
+  void recordTiming(uint32_t us) {
+    inferences++;
+    lastUs = us;
+    totalUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+};
+
+// ========================
+// 带标签的回放数据（主机上评估检测延迟和 CPU 开销）
+// ========================
+struct LabelledWindow {
+  FeatureVector features;
+  bool anomaly;                   // 标注：该窗口是否处于异常段
+};
+
+struct AnomalyReplayResult {
+  uint32_t windows;
+  uint32_t truePositives;
+  uint32_t falsePositives;
+  uint32_t falseNegatives;
+  uint32_t events;                // 标注的异常段数
+  uint32_t detectedEvents;
+  float meanLatencyWindows;       // 异常段开始到首次检出的窗口数
+  uint32_t maxLatencyWindows;
+  float meanInferenceUs;
+  uint32_t maxInferenceUs;
+};
+
+inline AnomalyReplayResult anomalyReplay(AnomalyDetector& detector, const std::vector<LabelledWindow>& data) {
+  AnomalyReplayResult res;
+  memset(&res, 0, sizeof(res));
+
+  bool inEvent = false;
+  bool eventDetected = false;
+  uint32_t eventStart = 0;
+  uint32_t latencySum = 0;
+
+  for (uint32_t i = 0; i < data.size(); i++) {
+    const LabelledWindow& w = data[i];
+    AnomalyResult r = detector.process(w.features);
+    res.windows++;
+
+    if (w.anomaly && !inEvent) {
+      inEvent = true;
+      eventDetected = false;
+      eventStart = i;
+      res.events++;
+    } else if (!w.anomaly) {
+      inEvent = false;
+    }
+
+    if (r.learning) continue;
+    if (r.anomalous && w.anomaly) res.truePositives++;
+    if (r.anomalous && !w.anomaly) res.falsePositives++;
+    if (!r.anomalous && w.anomaly) res.falseNegatives++;
+
+    if (inEvent && !eventDetected && r.anomalous) {
+      eventDetected = true;
+      res.detectedEvents++;
+      uint32_t latency = i - eventStart;
+      latencySum += latency;
+      if (latency > res.maxLatencyWindows) res.maxLatencyWindows = latency;
+    }
+  }
+
+  res.meanLatencyWindows = res.detectedEvents ? (float)latencySum / res.detectedEvents : 0;
+  res.meanInferenceUs = detector.getMeanInferenceUs();
+  res.maxInferenceUs = detector.getMaxInferenceUs();
+  return res;
+}
+
+#ifndef ARDUINO
+// ========================
+// 读取 CSV 数据集：每行 "label,f0,f1,..."（label 为 0 / 1，# 开头为注释）
+// ========================
+inline bool anomalyLoadCsv(const char* path, std::vector<LabelledWindow>& out) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+
+  char line[512];
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#' || line[0] == '\n') continue;
+    LabelledWindow w;
+    char* p = line;
+    w.anomaly = strtol(p, &p, 10) != 0;
+    w.features.count = 0;
+    while (*p == ',' && w.features.count < ANOMALY_MAX_FEATURES) {
+      w.features.values[w.features.count++] = strtof(p + 1, &p);
+    }
+    out.push_back(w);
+  }
+  fclose(f);
+  return true;
+}
+#endif
+
+#endif
@@ -0,0 +1,216 @@
+// include/boot_profiler.h
+#ifndef BOOT_PROFILER_H
+#define BOOT_PROFILER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <atomic>
+
+#define BOOT_MAX_PHASES 24
+// 报告文档容量：顶层 3 个成员 + 每个阶段一个数组元素和 4 成员对象（32 位上每阶段 80 字节）
+#define BOOT_REPORT_CAPACITY \
+  (JSON_OBJECT_SIZE(3) + JSON_ARRAY_SIZE(BOOT_MAX_PHASES) + BOOT_MAX_PHASES * JSON_OBJECT_SIZE(4))
+
+#define BOOT_CONCAT_INNER(a, b) a##b
+#define BOOT_CONCAT(a, b) BOOT_CONCAT_INNER(a, b)
+
+// ========================
+// 启动阶段记录（名称必须是字符串常量）
+// 时间以 micros() 为基准：设备端从应用启动（esp_timer 初始化）起计，
+// 不含 ROM / 二级引导程序耗时；主机端从进程启动起计
+// ========================
+struct BootPhase {
+  const char* name;
+  uint32_t startUs;
+  uint32_t durationUs;            // 0 表示尚未结束
+  uint8_t depth;                  // 嵌套层级
+  int8_t parent;                  // 同一任务中包含它的阶段（-1 表示顶层）
+};
+
+// ========================
+// 启动耗时分析
+// 各阶段可以在不同任务中并发记录（槽位用原子计数分配，每个槽位只由其所有者写入）；
+// 首条消息发出后调用 markFirstMessage()，之后的记录全部忽略（重连不会污染报告）；
+// 报告发布成功后再调用 finish()，发布失败时下次连接可重新上报同一份数据
+// ========================
+class BootProfiler {
+private:
+  BootPhase phases[BOOT_MAX_PHASES];
+  std::atomic<uint8_t> count;
+  std::atomic<bool> stopped;      // 已停止采集
+  std::atomic<bool> finished;     // 报告已送出
+  uint32_t firstMessageUs;
+
+public:
+  BootProfiler() {
+    count = 0;
+    stopped = false;
+    finished = false;
+    firstMessageUs = 0;
+  }
+
+  // 开始一个阶段，返回槽位编号（-1 表示已结束或槽位用尽）
+  int begin(const char* name) {
+    if (stopped) return -1;
+    uint8_t index = count.fetch_add(1);
+    if (index >= BOOT_MAX_PHASES) {
+      count = BOOT_MAX_PHASES;
+      return -1;
+    }
+    BootPhase& p = phases[index];
+    p.name = name;
+    p.depth = currentDepth()++;
+    p.parent = currentPhase();
+    currentPhase() = index;
+    p.durationUs = 0;
+    p.startUs = micros();
+    return index;
+  }
+
+  void end(int index) {
+    if (index < 0) return;
+    uint32_t elapsed = micros() - phases[index].startUs;
+    phases[index].durationUs = elapsed > 0 ? elapsed : 1;
+    currentDepth()--;
+    currentPhase() = phases[index].parent;
+  }
+
+  // 记录一个瞬时事件（如 "wifi.got_ip"）
+  void mark(const char* name) {
+    int index = begin(name);
+    if (index < 0) return;
+    phases[index].durationUs = 1;
+    currentDepth()--;
+    currentPhase() = phases[index].parent;
+  }
+
+  // 记录一个已知起止时间的顶层阶段（起止不在同一作用域时使用，如 Wi-Fi 关联）
+  void record(const char* name, uint32_t startUs, uint32_t durationUs) {
+    if (stopped) return;
+    uint8_t index = count.fetch_add(1);
+    if (index >= BOOT_MAX_PHASES) {
+      count = BOOT_MAX_PHASES;
+      return;
+    }
+    BootPhase& p = phases[index];
+    p.name = name;
+    p.depth = 0;
+    p.parent = -1;
+    p.startUs = startUs;
+    p.durationUs = durationUs > 0 ? durationUs : 1;
+  }
+
+  // 首条消息已发出：记录时间并停止采集（只有第一次调用生效）
+  void markFirstMessage() {
+    if (stopped) return;
+    firstMessageUs = micros();
+    stopped = true;
+  }
+
+  // 报告已送出
+  void finish() {
+    markFirstMessage();
+    finished = true;
+  }
+
+  // 嵌套层级按任务分别计数，并发任务中的阶段互不影响
+  static uint8_t& currentDepth() {
+    static thread_local uint8_t depth = 0;
+    return depth;
+  }
+
+  static int8_t& currentPhase() {
+    static thread_local int8_t open = -1;
+    return open;
+  }
+
+  bool isFinished() {
+    return finished;
+  }
+
+  uint8_t getPhaseCount() {
+    uint8_t n = count;
+    return n < BOOT_MAX_PHASES ? n : BOOT_MAX_PHASES;
+  }
+
+  const BootPhase& getPhase(uint8_t index) {
+    return phases[index];
+  }
+
+  uint32_t getFirstMessageUs() {
+    return firstMessageUs;
+  }
+
+  // 最耗时的叶子阶段（不含子阶段）；包装阶段（如 "startup.init"）的耗时只是子阶段之和，不参与比较
+  int slowestPhase() {
+    uint8_t n = getPhaseCount();
+    int slowest = -1;
+    for (uint8_t i = 0; i < n; i++) {
+      bool leaf = true;
+      for (uint8_t j = i + 1; j < n && leaf; j++) {
+        if (phases[j].parent == i) leaf = false;
+      }
+      if (!leaf) continue;
+      if (slowest < 0 || phases[i].durationUs > phases[slowest].durationUs) slowest = i;
+    }
+    return slowest;
+  }
+
+  // ========================
+  // 生成启动报告
+  // {"first_msg_us":..,"slowest":"wifi.connect","phases":[{"n":..,"s":..,"d":..,"l":..}]}
+  // ========================
+  void buildReport(JsonDocument& doc) {
+    doc["first_msg_us"] = firstMessageUs;
+    int slowest = slowestPhase();
+    if (slowest >= 0) doc["slowest"] = phases[slowest].name;
+
+    JsonArray list = doc.createNestedArray("phases");
+    for (uint8_t i = 0; i < getPhaseCount(); i++) {
+      const BootPhase& p = phases[i];
+      JsonObject o = list.createNestedObject();
+      o["n"] = p.name;
+      o["s"] = p.startUs;
+      o["d"] = p.durationUs;
+      if (p.depth) o["l"] = p.depth;
+    }
+  }
+
+  void printReport() {
+    Serial.println("\n=== Boot Profile ===");
+    for (uint8_t i = 0; i < getPhaseCount(); i++) {
+      const BootPhase& p = phases[i];
+      Serial.printf("%*s%-24s start %10u us  took %10u us\n", p.depth * 2, "", p.name,
+                    (unsigned)p.startUs, (unsigned)p.durationUs);
+    }
+    int slowest = slowestPhase();
+    if (slowest >= 0) Serial.printf("Slowest: %s\n", phases[slowest].name);
+    if (firstMessageUs) Serial.printf("Time to first message: %u us\n", (unsigned)firstMessageUs);
+  }
+};
+
+// ========================
+// 全局实例
+// ========================
+BootProfiler bootProfiler;
+
+// ========================
+// 作用域计时（析构时结束阶段）
+// ========================
+class BootPhaseScope {
+private:
+  int index;
+
+public:
+  BootPhaseScope(const char* name) {
+    index = bootProfiler.begin(name);
+  }
+
+  ~BootPhaseScope() {
+    bootProfiler.end(index);
+  }
+};
+
+#define BOOT_PHASE(name) BootPhaseScope BOOT_CONCAT(bootPhase_, __LINE__)(name)
+
+#endif
@@ -0,0 +1,468 @@
+// include/camera_thumbnail.h
+#ifndef CAMERA_THUMBNAIL_H
+#define CAMERA_THUMBNAIL_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include "psram_policy.h"
+
+#if defined(ESP32) && __has_include(<esp_camera.h>)
+  #include <esp_camera.h>
+  #include <img_converters.h>
+  #define THUMB_HAS_CAMERA 1
+#endif
+
+#define THUMB_MAX_PROFILES 4
+#define THUMB_MAX_REQUESTS 4
+
+// ========================
+// 缩略图档位（订阅者按档位选择分辨率和质量）
+// ========================
+struct ThumbnailProfile {
+  String name;                    // 发布到 <base>/thumb/<name>
+  uint16_t maxWidth;              // 输出不超过该尺寸，保持宽高比
+  uint16_t maxHeight;
+  uint8_t quality;                // JPEG 质量 1 ~ 100
+  uint32_t intervalMs;            // 自动发布间隔（0 表示只按需）
+  uint32_t lastPublish;
+};
+
+// 裁剪区域（源图像素坐标，width 为 0 表示整幅）
+struct CropRect {
+  uint16_t x;
+  uint16_t y;
+  uint16_t width;
+  uint16_t height;
+};
+
+struct ThumbnailResult {
+  uint16_t width;
+  uint16_t height;
+  uint32_t encodeUs;
+  bool hardware;                  // 由传感器直接输出
+};
+
+// ========================
+// 选择 JPEG 解码缩放（1/1、1/2、1/4、1/8），
+// 在解码阶段尽量缩小，同时保证裁剪区域仍不小于目标尺寸
+// ========================
+inline uint8_t thumbDecodeShift(uint16_t cropW, uint16_t cropH, uint16_t targetW, uint16_t targetH) {
+  uint8_t shift = 0;
+  while (shift < 3 && (cropW >> (shift + 1)) >= targetW && (cropH >> (shift + 1)) >= targetH) {
+    shift++;
+  }
+  return shift;
+}
+
+// 按宽高比把裁剪区域缩放进 maxW x maxH
+inline void thumbFitSize(uint16_t srcW, uint16_t srcH, uint16_t maxW, uint16_t maxH, uint16_t& outW, uint16_t& outH) {
+  if (srcW <= maxW && srcH <= maxH) {
+    outW = srcW;
+    outH = srcH;
+  } else if ((uint32_t)srcW * maxH >= (uint32_t)srcH * maxW) {
+    outW = maxW;
+    outH = (uint16_t)((uint32_t)srcH * maxW / srcW);
+  } else {
+    outH = maxH;
+    outW = (uint16_t)((uint32_t)srcW * maxH / srcH);
+  }
+  if (outW == 0) outW = 1;
+  if (outH == 0) outH = 1;
+}
+
+// ========================
+// RGB565（高字节在前，与 jpg2rgb565 / fmt2jpg 一致）裁剪 + 区域平均缩小
+// ========================
+inline void thumbScaleRgb565(const uint8_t* src, uint16_t srcW, const CropRect& crop,
+                             uint8_t* dst, uint16_t dstW, uint16_t dstH) {
+  for (uint16_t dy = 0; dy < dstH; dy++) {
+    uint32_t y0 = crop.y + (uint32_t)dy * crop.height / dstH;
+    uint32_t y1 = crop.y + (uint32_t)(dy + 1) * crop.height / dstH;
+    if (y1 <= y0) y1 = y0 + 1;
+
+    for (uint16_t dx = 0; dx < dstW; dx++) {
+      uint32_t x0 = crop.x + (uint32_t)dx * crop.width / dstW;
+      uint32_t x1 = crop.x + (uint32_t)(dx + 1) * crop.width / dstW;
+      if (x1 <= x0) x1 = x0 + 1;
+
+      uint32_t r = 0, g = 0, b = 0, n = 0;
+      for (uint32_t y = y0; y < y1; y++) {
+        const uint8_t* row = src + ((size_t)y * srcW + x0) * 2;
+        for (uint32_t x = x0; x < x1; x++, row += 2) {
+          uint16_t p = (row[0] << 8) | row[1];
+          r += p >> 11;
+          g += (p >> 5) & 0x3F;
+          b += p & 0x1F;
+          n++;
+        }
+      }
+
+      uint16_t p = (uint16_t)(((r / n) << 11) | ((g / n) << 5) | (b / n));
+      uint8_t* out = dst + ((size_t)dy * dstW + dx) * 2;
+      out[0] = p >> 8;
+      out[1] = p & 0xFF;
+    }
+  }
+}
+
+// ========================
+// 软件缩放基准（不需要摄像头和编解码器，主机和设备都可运行）
+// 对合成的 RGB565 渐变图做区域平均缩小并计时；同时检查：
+// - 纯色图缩小后颜色不变
+// - thumbFitSize 的输出不超过上限且宽高比误差小于 1 像素
+// - thumbDecodeShift 缩小后的裁剪区域仍不小于目标尺寸
+// ========================
+struct ThumbScaleBench {
+  float usPerFrame;
+  float megapixelsPerSec;         // 按源（裁剪区域）像素计
+  bool scaleOk;
+  bool fitOk;
+};
+
+inline bool thumbCheckFitMaths() {
+  static const uint16_t sizes[][2] = {{1600, 1200}, {1280, 720}, {640, 480}, {320, 240}, {96, 96}, {1, 1000}, {1000, 1}};
+  static const uint16_t targets[][2] = {{160, 120}, {320, 240}, {96, 96}, {64, 48}, {1, 1}};
+  for (auto& s : sizes) {
+    for (auto& t : targets) {
+      uint16_t w, h;
+      thumbFitSize(s[0], s[1], t[0], t[1], w, h);
+      uint16_t limitW = s[0] < t[0] ? s[0] : t[0];
+      uint16_t limitH = s[1] < t[1] ? s[1] : t[1];
+      if (w == 0 || h == 0 || w > limitW || h > limitH) return false;
+      // 取整只截断一条边（或把它补到 1 像素），误差小于源图的一行 / 一列
+      int32_t skew = (int32_t)w * s[1] - (int32_t)h * s[0];
+      int32_t tolerance = s[0] > s[1] ? s[0] : s[1];
+      if ((skew < 0 ? -skew : skew) >= tolerance) return false;
+
+      uint8_t shift = thumbDecodeShift(s[0], s[1], w, h);
+      if ((s[0] >> shift) < w || (s[1] >> shift) < h) return false;
+    }
+  }
+  return true;
+}
+
+inline ThumbScaleBench measureThumbScale(uint16_t srcW = 640, uint16_t srcH = 480, uint16_t maxW = 160,
+                                         uint16_t maxH = 120, uint16_t iterations = 20) {
+  ThumbScaleBench result = {0, 0, false, thumbCheckFitMaths()};
+  uint16_t dstW, dstH;
+  thumbFitSize(srcW, srcH, maxW, maxH, dstW, dstH);
+
+  uint8_t* src = (uint8_t*)memAlloc(BUF_FRAME, (size_t)srcW * srcH * 2);
+  uint8_t* dst = (uint8_t*)memAlloc(BUF_FRAME, (size_t)dstW * dstH * 2);
+  if (src == nullptr || dst == nullptr) {
+    memFree(BUF_FRAME, src);
+    memFree(BUF_FRAME, dst);
+    return result;
+  }
+  CropRect whole = {0, 0, srcW, srcH};
+
+  // 纯色：每个输出像素应与输入相同
+  const uint16_t color = 0x7BEF;
+  for (size_t i = 0; i < (size_t)srcW * srcH; i++) {
+    src[i * 2] = color >> 8;
+    src[i * 2 + 1] = color & 0xFF;
+  }
+  thumbScaleRgb565(src, srcW, whole, dst, dstW, dstH);
+  result.scaleOk = true;
+  for (size_t i = 0; i < (size_t)dstW * dstH; i++) {
+    if (((dst[i * 2] << 8) | dst[i * 2 + 1]) != color) result.scaleOk = false;
+  }
+
+  // 渐变图计时
+  for (uint16_t y = 0; y < srcH; y++) {
+    for (uint16_t x = 0; x < srcW; x++) {
+      uint16_t p = (uint16_t)(((x * 31 / srcW) << 11) | ((y * 63 / srcH) << 5) | ((x + y) & 0x1F));
+      src[((size_t)y * srcW + x) * 2] = p >> 8;
+      src[((size_t)y * srcW + x) * 2 + 1] = p & 0xFF;
+    }
+  }
+  if (iterations == 0) iterations = 1;
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < iterations; i++) {
+    thumbScaleRgb565(src, srcW, whole, dst, dstW, dstH);
+  }
+  uint32_t elapsed = micros() - start;
+  if (elapsed == 0) elapsed = 1;
+  result.usPerFrame = (float)elapsed / iterations;
+  result.megapixelsPerSec = (float)srcW * srcH * iterations / elapsed;
+
+  memFree(BUF_FRAME, src);
+  memFree(BUF_FRAME, dst);
+  Serial.printf("Thumbnail scale %ux%u -> %ux%u: %.0f us/frame, %.1f Mpix/s, scale %s, fit %s\n",
+                (unsigned)srcW, (unsigned)srcH, (unsigned)dstW, (unsigned)dstH, result.usPerFrame,
+                result.megapixelsPerSec, result.scaleOk ? "✓" : "✗", result.fitOk ? "✓" : "✗");
+  return result;
+}
+
+#ifdef THUMB_HAS_CAMERA
+#include "mqtt_manager.h"
+
+// ========================
+// esp32cam 缩略图 / 裁剪发布
+// 整幅缩略图优先让传感器直接输出较小分辨率（硬件缩放）；
+// 需要裁剪或无合适分辨率时走软件路径：
+// JPEG 解码时按 1/2^n 缩小 -> RGB565 裁剪和区域平均 -> 重新编码
+// 请求：<base>/thumb/get  {"profile":"low","crop":[x,y,w,h]}
+// ========================
+class CameraThumbnailer {
+private:
+  struct Request {
+    uint8_t profile;
+    CropRect crop;
+  };
+
+  MQTTManager& manager;
+  String baseTopic;
+  String requestTopic;
+  ThumbnailProfile profiles[THUMB_MAX_PROFILES];
+  uint8_t profileCount;
+  std::vector<Request> requests;
+  bool hardwareScaling;
+
+public:
+  CameraThumbnailer(MQTTManager& mqttManager) : manager(mqttManager) {
+    profileCount = 0;
+    hardwareScaling = true;
+  }
+
+  // ========================
+  // 初始化（摄像头需已由 esp_camera_init 启动）
+  // ========================
+  void begin(const char* base = "camera") {
+    baseTopic = String(base);
+    String sub = baseTopic + "/thumb/get";
+    requestTopic = manager.getFullTopic(sub.c_str());
+    manager.registerTopic(sub.c_str());
+    manager.addMessageObserver([this](const char* topic, JsonDocument& doc) {
+      if (requestTopic == topic) this->onRequest(doc);
+    });
+  }
+
+  bool addProfile(const char* name, uint16_t maxWidth, uint16_t maxHeight, uint8_t quality, uint32_t intervalMs = 0) {
+    if (profileCount >= THUMB_MAX_PROFILES) return false;
+    profiles[profileCount++] = {String(name), maxWidth, maxHeight, quality, intervalMs, 0};
+    return true;
+  }
+
+  // 硬件缩放会改变传感器输出分辨率，与其他取帧者共用摄像头时可关闭
+  void setHardwareScaling(bool enabled) {
+    hardwareScaling = enabled;
+  }
+
+  // ========================
+  // 在 loop 中调用：处理按需请求和定时档位
+  // ========================
+  void loop() {
+    if (!manager.isConnected()) return;
+
+    if (!requests.empty()) {
+      Request r = requests.front();
+      requests.erase(requests.begin());
+      publishThumbnail(r.profile, r.crop);
+      return;                     // 每次 loop 最多一帧，避免长时间阻塞
+    }
+
+    for (uint8_t i = 0; i < profileCount; i++) {
+      ThumbnailProfile& p = profiles[i];
+      if (p.intervalMs > 0 && millis() - p.lastPublish >= p.intervalMs) {
+        publishThumbnail(i, CropRect{0, 0, 0, 0});
+        return;
+      }
+    }
+  }
+
+  // ========================
+  // 生成并发布一幅缩略图
+  // ========================
+  bool publishThumbnail(uint8_t index, const CropRect& crop) {
+    ThumbnailProfile& p = profiles[index];
+    p.lastPublish = millis();
+
+    std::vector<uint8_t> jpeg;
+    ThumbnailResult result;
+    if (!produce(p, crop, jpeg, result)) {
+      Serial.println("✗ Thumbnail failed: " + p.name);
+      return false;
+    }
+
+    String topic = baseTopic + "/thumb/" + p.name;
+    bool ok = manager.publishBinary(topic.c_str(), jpeg.data(), jpeg.size());
+
+    PolicyJsonDocument meta(192);
+    meta["w"] = result.width;
+    meta["h"] = result.height;
+    meta["bytes"] = jpeg.size();
+    meta["q"] = p.quality;
+    meta["us"] = result.encodeUs;
+    meta["hw"] = result.hardware;
+    String metaTopic = topic + "/meta";
+    manager.publishJson(metaTopic.c_str(), meta, PRIORITY_URGENT);
+    return ok;
+  }
+
+  // ========================
+  // 生成缩略图 JPEG
+  // ========================
+  bool produce(const ThumbnailProfile& p, const CropRect& crop, std::vector<uint8_t>& out, ThumbnailResult& result) {
+    uint32_t start = micros();
+    bool ok = false;
+    result.hardware = false;
+
+    if (hardwareScaling && crop.width == 0) {
+      ok = produceHardware(p, out, result);
+    }
+    if (!ok) {
+      ok = produceSoftware(p, crop, out, result);
+    }
+    result.encodeUs = micros() - start;
+    return ok;
+  }
+
+private:
+  // 缺少或未知的档位不再回退到第一个档位，以免拼写错误换来意外的分辨率和质量
+  void onRequest(JsonDocument& doc) {
+    const char* name = doc["profile"] | "";
+    int index = -1;
+    for (uint8_t i = 0; i < profileCount; i++) {
+      if (profiles[i].name == name) index = i;
+    }
+    if (index < 0) {
+      rejectRequest(name);
+      return;
+    }
+    if (requests.size() >= THUMB_MAX_REQUESTS) return;
+
+    CropRect crop = {0, 0, 0, 0};
+    JsonArray c = doc["crop"];
+    if (!c.isNull() && c.size() == 4) {
+      crop = {c[0].as<uint16_t>(), c[1].as<uint16_t>(), c[2].as<uint16_t>(), c[3].as<uint16_t>()};
+    }
+    requests.push_back({(uint8_t)index, crop});
+  }
+
+  // 在该档位的 meta 主题上回复错误；名称为空或含主题分隔 / 通配符时只记录日志
+  void rejectRequest(const char* name) {
+    if (name[0] == '\0' || strpbrk(name, "/+#") != nullptr) {
+      Serial.printf("⚠ Thumbnail request rejected: invalid profile \"%s\"\n", name);
+      return;
+    }
+    Serial.printf("⚠ Thumbnail request rejected: unknown profile \"%s\"\n", name);
+    PolicyJsonDocument meta(128);
+    meta["profile"] = name;
+    meta["error"] = "unknown profile";
+    String metaTopic = baseTopic + "/thumb/" + name + "/meta";
+    manager.publishJson(metaTopic.c_str(), meta, PRIORITY_URGENT);
+  }
+
+  // ========================
+  // 硬件路径：切换传感器到不超过目标的最大分辨率，取一帧后恢复
+  // ========================
+  bool produceHardware(const ThumbnailProfile& p, std::vector<uint8_t>& out, ThumbnailResult& result) {
+    sensor_t* s = esp_camera_sensor_get();
+    if (s == nullptr || s->pixformat != PIXFORMAT_JPEG) return false;
+
+    framesize_t original = s->status.framesize;
+    int originalQuality = s->status.quality;
+    framesize_t best = FRAMESIZE_INVALID;
+    for (int f = 0; f < FRAMESIZE_INVALID && f <= (int)original; f++) {
+      if (resolution[f].width <= p.maxWidth && resolution[f].height <= p.maxHeight) {
+        if (best == FRAMESIZE_INVALID || resolution[f].width > resolution[best].width) best = (framesize_t)f;
+      }
+    }
+    // 可用的传感器分辨率比目标小一半以上时改走软件路径
+    if (best == FRAMESIZE_INVALID || resolution[best].width * 2 < p.maxWidth) return false;
+
+    s->set_framesize(s, best);
+    // 传感器质量 0（最好）~ 63（最差）
+    s->set_quality(s, 63 - (p.quality * 53) / 100);
+
+    // 切换后第一帧可能仍是旧分辨率
+    camera_fb_t* fb = esp_camera_fb_get();
+    if (fb) esp_camera_fb_return(fb);
+    fb = esp_camera_fb_get();
+
+    bool ok = fb != nullptr && fb->width == resolution[best].width;
+    if (ok) {
+      out.assign(fb->buf, fb->buf + fb->len);
+      result.width = fb->width;
+      result.height = fb->height;
+      result.hardware = true;
+    }
+    if (fb) esp_camera_fb_return(fb);
+
+    s->set_framesize(s, original);
+    s->set_quality(s, originalQuality);
+    return ok;
+  }
+
+  // ========================
+  // 软件路径
+  // ========================
+  bool produceSoftware(const ThumbnailProfile& p, CropRect crop, std::vector<uint8_t>& out, ThumbnailResult& result) {
+    camera_fb_t* fb = esp_camera_fb_get();
+    if (fb == nullptr) return false;
+
+    uint16_t srcW = fb->width;
+    uint16_t srcH = fb->height;
+    if (crop.width == 0 || crop.x + crop.width > srcW || crop.y + crop.height > srcH) {
+      crop = {0, 0, srcW, srcH};
+    }
+
+    uint16_t dstW, dstH;
+    thumbFitSize(crop.width, crop.height, p.maxWidth, p.maxHeight, dstW, dstH);
+
+    // 解码到 RGB565（JPEG 在解码时按 2 的幂缩小，减少 IDCT 和内存）
+    uint8_t shift = 0;
+    uint8_t* rgb = nullptr;
+    bool ownsRgb = false;
+    if (fb->format == PIXFORMAT_JPEG) {
+      shift = thumbDecodeShift(crop.width, crop.height, dstW, dstH);
+      size_t size = (size_t)(srcW >> shift) * (srcH >> shift) * 2;
+      rgb = (uint8_t*)allocFrame(size);
+      if (rgb == nullptr || !jpg2rgb565(fb->buf, fb->len, rgb, (jpg_scale_t)shift)) {
+        memFree(BUF_FRAME, rgb);
+        esp_camera_fb_return(fb);
+        return false;
+      }
+      ownsRgb = true;
+    } else if (fb->format == PIXFORMAT_RGB565) {
+      rgb = fb->buf;
+    } else {
+      esp_camera_fb_return(fb);
+      return false;
+    }
+
+    CropRect scaled = {(uint16_t)(crop.x >> shift), (uint16_t)(crop.y >> shift),
+                       (uint16_t)(crop.width >> shift), (uint16_t)(crop.height >> shift)};
+    uint8_t* small = (uint8_t*)allocFrame((size_t)dstW * dstH * 2);
+    bool ok = small != nullptr;
+    if (ok) {
+      thumbScaleRgb565(rgb, srcW >> shift, scaled, small, dstW, dstH);
+    }
+
+    if (ownsRgb) memFree(BUF_FRAME, rgb);
+    esp_camera_fb_return(fb);
+
+    uint8_t* jpg = nullptr;
+    size_t jpgLen = 0;
+    ok = ok && fmt2jpg(small, (size_t)dstW * dstH * 2, dstW, dstH, PIXFORMAT_RGB565, p.quality, &jpg, &jpgLen);
+    memFree(BUF_FRAME, small);
+    if (ok) {
+      out.assign(jpg, jpg + jpgLen);
+      result.width = dstW;
+      result.height = dstH;
+    }
+    free(jpg);
+    return ok;
+  }
+
+  // 帧缓冲按 BUF_FRAME 策略放置（默认 PSRAM）
+  static void* allocFrame(size_t size) {
+    return memAlloc(BUF_FRAME, size);
+  }
+};
+
+#endif
+
+#endif
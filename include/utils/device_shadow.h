@@ -0,0 +1,228 @@
+// include/device_shadow.h
+#ifndef DEVICE_SHADOW_H
+#define DEVICE_SHADOW_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include "string_intern.h"
+
+// ========================
+// 期望值回调：返回 true 表示已应用（自动回写为上报值）
+// ========================
+typedef bool (*ShadowDesiredCallback)(const char* key, JsonVariant value);
+
+// ========================
+// 影子属性结构体
+// ========================
+struct ShadowProperty {
+  InternedString key;               // 属性名（驻留字符串，作为 JSON 键时不复制）
+  String value;                     // 上报值（序列化后的 JSON 片段）
+  uint32_t version;                 // 最后一次修改时的文档版本
+  bool dirty;                       // 是否待上报
+  ShadowDesiredCallback onDesired;  // 期望值回调
+};
+
+// ========================
+// 设备影子（reported / desired 状态同步）
+//
+// 上报: {"version":12,"state":{"led":true},"versions":{"led":12}}
+// 期望: {"version":7,"state":{"led":false}}
+// 只有发生变化的属性会被上报；版本号不大于已处理版本的期望消息会被丢弃
+// ========================
+class DeviceShadow {
+private:
+  std::vector<ShadowProperty> properties;
+  uint32_t reportedVersion;         // 上报文档版本（每次属性变化递增）
+  uint32_t desiredVersion;          // 已处理的最新期望版本
+  bool debugEnabled;
+
+public:
+  DeviceShadow() {
+    reportedVersion = 0;
+    desiredVersion = 0;
+    debugEnabled = true;
+  }
+
+  // ========================
+  // 注册属性
+  // ========================
+  void registerProperty(const char* key, ShadowDesiredCallback onDesired = nullptr) {
+    if (findProperty(key) != nullptr) {
+      return;
+    }
+
+    ShadowProperty prop;
+    prop.key = InternedString(key);
+    prop.value = "null";
+    prop.version = 0;
+    prop.dirty = false;
+    prop.onDesired = onDesired;
+    properties.push_back(prop);
+  }
+
+  // ========================
+  // 设置上报值（值未变化时不产生上报）
+  // ========================
+  template <typename T>
+  bool setReported(const char* key, T value) {
+    StaticJsonDocument<64> tmp;
+    tmp.set(value);
+    return setReportedFrom(key, tmp);
+  }
+
+  // 字符串值按长度分配（固定 64 字节的文档放不下长字符串，会变成 null）
+  bool setReported(const char* key, const char* value) {
+    DynamicJsonDocument tmp(JSON_STRING_SIZE(strlen(value)) + 16);
+    tmp.set(value);
+    return setReportedFrom(key, tmp);
+  }
+
+  bool setReported(const char* key, const String& value) {
+    DynamicJsonDocument tmp(JSON_STRING_SIZE(value.length()) + 16);
+    tmp.set(value);
+    return setReportedFrom(key, tmp);
+  }
+
+  bool setReportedRaw(const char* key, const String& json) {
+    ShadowProperty* prop = findProperty(key);
+    if (prop == nullptr) {
+      if (debugEnabled) Serial.println("⚠ Shadow property not registered: " + String(key));
+      return false;
+    }
+    if (prop->value == json) {
+      return false;
+    }
+
+    prop->value = json;
+    prop->version = ++reportedVersion;
+    prop->dirty = true;
+    return true;
+  }
+
+  // ========================
+  // 处理期望状态增量
+  // ========================
+  bool applyDesired(JsonDocument& doc) {
+    uint32_t version = doc["version"] | 0;
+    if (version != 0 && version <= desiredVersion) {
+      if (debugEnabled) {
+        Serial.printf("⚠ Stale shadow delta ignored: v%u <= v%u\n", (unsigned)version, (unsigned)desiredVersion);
+      }
+      return false;
+    }
+    if (version != 0) {
+      desiredVersion = version;
+    }
+
+    JsonObject state = doc["state"];
+    for (JsonPair kv : state) {
+      ShadowProperty* prop = findProperty(kv.key().c_str());
+      if (prop == nullptr) {
+        continue;
+      }
+
+      bool accepted = true;
+      if (prop->onDesired != nullptr) {
+        accepted = prop->onDesired(prop->key.c_str(), kv.value());
+      }
+      if (accepted) {
+        String json;
+        serializeJson(kv.value(), json);
+        setReportedRaw(prop->key.c_str(), json);
+      }
+    }
+    return true;
+  }
+
+  // ========================
+  // 是否有待上报的变化
+  // ========================
+  bool hasChanges() {
+    for (auto& prop : properties) {
+      if (prop.dirty) return true;
+    }
+    return false;
+  }
+
+  // ========================
+  // 标记全部属性待上报（全量同步）
+  // ========================
+  void markAllDirty() {
+    for (auto& prop : properties) {
+      prop.dirty = true;
+    }
+  }
+
+  // ========================
+  // 增量上报文档所需容量（按待上报属性估算）
+  // ========================
+  size_t reportedCapacity() {
+    size_t capacity = JSON_OBJECT_SIZE(4) + 32;
+    for (auto& prop : properties) {
+      if (!prop.dirty) continue;
+      capacity += 2 * JSON_OBJECT_SIZE(1) + JSON_STRING_SIZE(prop.value.length());
+    }
+    return capacity;
+  }
+
+  // ========================
+  // 构建增量上报文档，容量不足时返回 false（不能据此清除脏标记）
+  // ========================
+  bool buildReported(JsonDocument& doc) {
+    doc["version"] = reportedVersion;
+    doc["desired_version"] = desiredVersion;
+    JsonObject state = doc.createNestedObject("state");
+    JsonObject versions = doc.createNestedObject("versions");
+
+    for (auto& prop : properties) {
+      if (!prop.dirty) continue;
+      state[prop.key.c_str()] = serialized(prop.value);
+      versions[prop.key.c_str()] = prop.version;
+    }
+    return !doc.overflowed();
+  }
+
+  // ========================
+  // 上报成功后清除脏标记
+  // ========================
+  void clearChanges() {
+    for (auto& prop : properties) {
+      prop.dirty = false;
+    }
+  }
+
+  uint32_t getReportedVersion() {
+    return reportedVersion;
+  }
+
+  uint32_t getDesiredVersion() {
+    return desiredVersion;
+  }
+
+  void setDebug(bool enabled) {
+    debugEnabled = enabled;
+  }
+
+private:
+  bool setReportedFrom(const char* key, JsonDocument& tmp) {
+    if (tmp.overflowed()) {
+      if (debugEnabled) Serial.println("✗ Shadow value too large: " + String(key));
+      return false;
+    }
+    String json;
+    serializeJson(tmp, json);
+    return setReportedRaw(key, json);
+  }
+
+  ShadowProperty* findProperty(const char* key) {
+    InternedString id;
+    if (!InternedString::lookup(key, id)) return nullptr;
+    for (auto& prop : properties) {
+      if (prop.key == id) return &prop;
+    }
+    return nullptr;
+  }
+};
+
+#endif
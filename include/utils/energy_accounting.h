@@ -0,0 +1,220 @@
+// include/energy_accounting.h
+#ifndef ENERGY_ACCOUNTING_H
+#define ENERGY_ACCOUNTING_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ========================
+// 射频能耗模型（ESP32 数据手册典型值，可按实测修改）
+// ========================
+#define ENERGY_TX_CURRENT_MA 190.0f       // 发射电流
+#define ENERGY_RX_CURRENT_MA 100.0f       // 接收 / 监听电流
+#define ENERGY_PHY_RATE_KBPS 6000.0f      // 有效空口速率
+#define ENERGY_PACKET_OVERHEAD 90         // TCP/IP + 802.11 头部（字节）
+#define ENERGY_WAKE_TAIL_US 3000          // 每次发送后射频保持开启的时间
+#define ENERGY_TOPIC_SLOTS 8              // 按主题统计的条目数
+#define ENERGY_TOPIC_LEN 32               // 主题名最大长度（含结束符），更长的归入 "*"
+#define ENERGY_PRIORITY_LEVELS 3
+
+// ========================
+// 能耗子系统
+// ========================
+enum EnergySubsystem : uint8_t {
+  ENERGY_PUBLISH = 0,     // 应用消息
+  ENERGY_STATUS,          // 状态 / 上线 / 影子 / 能耗报告
+  ENERGY_RECONNECT,       // 连接与重连
+  ENERGY_SUBSCRIBE,       // 订阅同步
+  ENERGY_RECEIVE,         // 下行消息
+  ENERGY_SUBSYSTEM_COUNT
+};
+
+struct EnergyCounter {
+  uint32_t events;
+  uint32_t txBytes;
+  uint32_t rxBytes;
+  uint32_t radioOnUs;
+  float microAmpHours;
+};
+
+struct EnergyTopicStat {
+  char topic[ENERGY_TOPIC_LEN];   // 发布主题可以是任意字符串，复制保存而不驻留
+  EnergyCounter counter;
+};
+
+// ========================
+// 射频能耗统计
+// ========================
+class EnergyAccounting {
+private:
+  EnergyCounter subsystems[ENERGY_SUBSYSTEM_COUNT];
+  EnergyCounter priorities[ENERGY_PRIORITY_LEVELS];
+  EnergyTopicStat topicStats[ENERGY_TOPIC_SLOTS];
+  uint8_t topicCount;                     // 已命名的主题槽位（不含最后的 "*" 槽位）
+  uint32_t since;                         // 统计起点（毫秒）
+  bool inBurst;                           // 发送窗口内连续发送
+  bool burstTailPaid;                     // 窗口内的射频拖尾已计入
+
+public:
+  EnergyAccounting() {
+    reset();
+  }
+
+  void reset() {
+    memset(subsystems, 0, sizeof(subsystems));
+    memset(priorities, 0, sizeof(priorities));
+    for (auto& t : topicStats) {
+      t.topic[0] = '\0';
+      memset(&t.counter, 0, sizeof(t.counter));
+    }
+    topicCount = 0;
+    since = millis();
+    inBurst = false;
+    burstTailPaid = false;
+  }
+
+  // ========================
+  // 发送窗口：窗口内的消息共享一次射频唤醒拖尾
+  // ========================
+  void beginBurst() {
+    inBurst = true;
+    burstTailPaid = false;
+  }
+
+  void endBurst() {
+    inBurst = false;
+  }
+
+  // ========================
+  // 估算一次发送的射频开启时间（微秒）
+  // ========================
+  static uint32_t estimateTxUs(uint32_t bytes) {
+    float airtimeUs = (bytes + ENERGY_PACKET_OVERHEAD) * 8 * 1000.0f / ENERGY_PHY_RATE_KBPS;
+    return (uint32_t)airtimeUs + ENERGY_WAKE_TAIL_US;
+  }
+
+  static float toMicroAmpHours(float currentMa, uint32_t us) {
+    // mA * us -> µAh : mA * 1000 * us / 3.6e9
+    return currentMa * us / 3600000.0f;
+  }
+
+  // ========================
+  // 记录一次发送
+  // ========================
+  void recordTx(EnergySubsystem subsystem, const char* topic, uint32_t bytes, uint8_t priority = 1) {
+    uint32_t airUs = estimateTxUs(bytes);
+    uint32_t tailUs = ENERGY_WAKE_TAIL_US;
+    if (inBurst) {
+      if (burstTailPaid) {
+        airUs -= ENERGY_WAKE_TAIL_US;
+        tailUs = 0;
+      }
+      burstTailPaid = true;
+    }
+    float uah = toMicroAmpHours(ENERGY_TX_CURRENT_MA, airUs - tailUs) +
+                toMicroAmpHours(ENERGY_RX_CURRENT_MA, tailUs);
+
+    add(subsystems[subsystem], bytes, 0, airUs, uah);
+    if (priority < ENERGY_PRIORITY_LEVELS) {
+      add(priorities[priority], bytes, 0, airUs, uah);
+    }
+    if (topic) {
+      EnergyTopicStat* stat = topicSlot(topic);
+      if (stat) add(stat->counter, bytes, 0, airUs, uah);
+    }
+  }
+
+  // ========================
+  // 记录一次接收
+  // ========================
+  void recordRx(uint32_t bytes) {
+    uint32_t airUs = estimateTxUs(bytes);
+    add(subsystems[ENERGY_RECEIVE], 0, bytes, airUs, toMicroAmpHours(ENERGY_RX_CURRENT_MA, airUs));
+  }
+
+  // ========================
+  // 记录实测的射频开启时间（如连接握手）
+  // ========================
+  void recordRadioOn(EnergySubsystem subsystem, uint32_t radioOnUs, uint32_t txBytes = 0) {
+    uint32_t txUs = txBytes ? estimateTxUs(txBytes) - ENERGY_WAKE_TAIL_US : 0;
+    uint32_t rxUs = radioOnUs > txUs ? radioOnUs - txUs : 0;
+    float uah = toMicroAmpHours(ENERGY_TX_CURRENT_MA, txUs) + toMicroAmpHours(ENERGY_RX_CURRENT_MA, rxUs);
+    add(subsystems[subsystem], txBytes, 0, radioOnUs, uah);
+  }
+
+  // ========================
+  // 总能耗（µAh）
+  // ========================
+  float totalMicroAmpHours() {
+    float total = 0;
+    for (auto& c : subsystems) total += c.microAmpHours;
+    return total;
+  }
+
+  // ========================
+  // 生成能耗报告
+  // ========================
+  void buildReport(JsonDocument& doc) {
+    static const char* names[ENERGY_SUBSYSTEM_COUNT] = {"publish", "status", "reconnect", "subscribe", "receive"};
+    static const char* priorityNames[ENERGY_PRIORITY_LEVELS] = {"urgent", "normal", "bulk"};
+
+    doc["period_s"] = (millis() - since) / 1000;
+    doc["total_uah"] = totalMicroAmpHours();
+
+    JsonObject subs = doc.createNestedObject("subsystems");
+    for (uint8_t i = 0; i < ENERGY_SUBSYSTEM_COUNT; i++) {
+      if (subsystems[i].events == 0) continue;
+      writeCounter(subs.createNestedObject(names[i]), subsystems[i]);
+    }
+
+    JsonObject prio = doc.createNestedObject("priorities");
+    for (uint8_t i = 0; i < ENERGY_PRIORITY_LEVELS; i++) {
+      if (priorities[i].events == 0) continue;
+      prio[priorityNames[i]] = priorities[i].microAmpHours;
+    }
+
+    JsonObject topics = doc.createNestedObject("topics");
+    for (uint8_t i = 0; i < ENERGY_TOPIC_SLOTS; i++) {
+      if (topicStats[i].topic[0] == '\0') continue;
+      topics[(const char*)topicStats[i].topic] = topicStats[i].counter.microAmpHours;
+    }
+  }
+
+  const EnergyCounter& getSubsystem(EnergySubsystem subsystem) {
+    return subsystems[subsystem];
+  }
+
+private:
+  static void add(EnergyCounter& c, uint32_t tx, uint32_t rx, uint32_t us, float uah) {
+    c.events++;
+    c.txBytes += tx;
+    c.rxBytes += rx;
+    c.radioOnUs += us;
+    c.microAmpHours += uah;
+  }
+
+  static void writeCounter(JsonObject obj, const EnergyCounter& c) {
+    obj["n"] = c.events;
+    obj["tx"] = c.txBytes;
+    obj["rx"] = c.rxBytes;
+    obj["on_ms"] = c.radioOnUs / 1000;
+    obj["uah"] = c.microAmpHours;
+  }
+
+  // 主题槽位满或主题名过长时归入最后一个 "*" 槽位
+  EnergyTopicStat* topicSlot(const char* topic) {
+    for (uint8_t i = 0; i < topicCount; i++) {
+      if (strcmp(topicStats[i].topic, topic) == 0) return &topicStats[i];
+    }
+    if (topicCount < ENERGY_TOPIC_SLOTS - 1 && strlen(topic) < ENERGY_TOPIC_LEN) {
+      strcpy(topicStats[topicCount].topic, topic);
+      return &topicStats[topicCount++];
+    }
+    if (topicStats[ENERGY_TOPIC_SLOTS - 1].topic[0] == '\0') {
+      strcpy(topicStats[ENERGY_TOPIC_SLOTS - 1].topic, "*");
+    }
+    return &topicStats[ENERGY_TOPIC_SLOTS - 1];
+  }
+};
+
+#endif
@@ -0,0 +1,185 @@
+// include/event_bus.h
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <Arduino.h>
+#include <type_traits>
+#include <vector>
+
+// ========================
+// 事件总线配置
+// ========================
+#define EVENT_POOL_BLOCKS 16          // 池中事件块数量
+#define EVENT_PAYLOAD_SIZE 64         // 每个事件的最大负载（字节）
+
+class EventBus;
+
+// ========================
+// 事件块（引用计数，归还到池中而不是释放）
+// ========================
+struct EventBlock {
+  uint16_t refCount;
+  uint16_t type;
+  uint16_t size;
+  uint16_t next;                      // 空闲链表
+  alignas(8) uint8_t payload[EVENT_PAYLOAD_SIZE];
+};
+
+// ========================
+// 事件引用（拷贝只增加引用计数，不复制负载）
+// ========================
+class EventRef {
+private:
+  EventBus* bus;
+  EventBlock* block;
+
+public:
+  EventRef() : bus(nullptr), block(nullptr) {}
+  EventRef(EventBus* owner, EventBlock* b) : bus(owner), block(b) {
+    if (block) block->refCount++;
+  }
+  EventRef(const EventRef& other) : bus(other.bus), block(other.block) {
+    if (block) block->refCount++;
+  }
+  EventRef& operator=(const EventRef& other) {
+    if (this != &other) {
+      release();
+      bus = other.bus;
+      block = other.block;
+      if (block) block->refCount++;
+    }
+    return *this;
+  }
+  ~EventRef() {
+    release();
+  }
+
+  bool valid() const { return block != nullptr; }
+  uint16_t type() const { return block->type; }
+  uint16_t size() const { return block->size; }
+  const void* data() const { return block->payload; }
+
+  template <typename T>
+  const T& as() const {
+    return *reinterpret_cast<const T*>(block->payload);
+  }
+
+private:
+  inline void release();
+};
+
+// ========================
+// 订阅回调（在发布者的任务中同步调用）
+// ========================
+typedef void (*EventHandler)(const EventRef& event, void* context);
+
+struct EventSubscriber {
+  uint16_t type;                      // 0 表示订阅所有类型
+  EventHandler handler;
+  void* context;
+};
+
+// ========================
+// 进程内事件总线
+// 负载只写入一次池块，所有订阅者共享同一块内存；
+// 仅供 loop 所在任务使用，其他任务请通过 MQTTManager::publishFromTask
+// ========================
+class EventBus {
+private:
+  EventBlock pool[EVENT_POOL_BLOCKS];
+  uint16_t freeHead;
+  uint16_t freeCount;
+  uint32_t droppedEvents;
+  std::vector<EventSubscriber> subscribers;
+
+  friend class EventRef;
+
+public:
+  EventBus() {
+    for (uint16_t i = 0; i < EVENT_POOL_BLOCKS; i++) {
+      pool[i].refCount = 0;
+      pool[i].next = i + 1;
+    }
+    freeHead = 0;
+    freeCount = EVENT_POOL_BLOCKS;
+    droppedEvents = 0;
+  }
+
+  // ========================
+  // 订阅事件类型
+  // ========================
+  void subscribe(uint16_t type, EventHandler handler, void* context = nullptr) {
+    subscribers.push_back({type, handler, context});
+  }
+
+  void unsubscribe(EventHandler handler, void* context = nullptr) {
+    for (auto it = subscribers.begin(); it != subscribers.end();) {
+      if (it->handler == handler && it->context == context) {
+        it = subscribers.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // ========================
+  // 发布类型化事件（负载必须可平凡拷贝）
+  // ========================
+  template <typename T>
+  bool publish(uint16_t type, const T& payload) {
+    static_assert(std::is_trivially_copyable<T>::value, "Event payload must be trivially copyable");
+    static_assert(sizeof(T) <= EVENT_PAYLOAD_SIZE, "Event payload exceeds EVENT_PAYLOAD_SIZE");
+    return publishRaw(type, &payload, sizeof(T));
+  }
+
+  bool publishRaw(uint16_t type, const void* payload, uint16_t size) {
+    if (size > EVENT_PAYLOAD_SIZE || freeCount == 0) {
+      droppedEvents++;
+      return false;
+    }
+
+    EventBlock* block = &pool[freeHead];
+    freeHead = block->next;
+    freeCount--;
+
+    block->type = type;
+    block->size = size;
+    memcpy(block->payload, payload, size);
+
+    // 发布者持有一个引用，分发结束后释放；订阅者可拷贝 EventRef 延长生命周期
+    EventRef event(this, block);
+    for (size_t i = 0; i < subscribers.size(); i++) {
+      if (subscribers[i].type == 0 || subscribers[i].type == type) {
+        subscribers[i].handler(event, subscribers[i].context);
+      }
+    }
+    return true;
+  }
+
+  uint16_t availableBlocks() const {
+    return freeCount;
+  }
+
+  uint32_t getDroppedCount() const {
+    return droppedEvents;
+  }
+
+private:
+  void releaseBlock(EventBlock* block) {
+    if (--block->refCount == 0) {
+      block->next = freeHead;
+      freeHead = (uint16_t)(block - pool);
+      freeCount++;
+    }
+  }
+};
+
+inline void EventRef::release() {
+  if (block) {
+    bus->releaseBlock(block);
+    block = nullptr;
+    bus = nullptr;
+  }
+}
+
+#endif
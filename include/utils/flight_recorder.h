@@ -0,0 +1,160 @@
+// include/flight_recorder.h
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <Arduino.h>
+#include <vector>
+
+#ifdef ESP32
+  #include <esp_attr.h>
+  #include <esp_system.h>
+  #include <esp_timer.h>
+#endif
+
+// ESP8266 / 主机构建没有 RTC 段，退化为普通 RAM（不跨复位保留）
+#ifndef RTC_NOINIT_ATTR
+  #define RTC_NOINIT_ATTR
+#endif
+
+// ========================
+// 飞行记录器配置
+// ========================
+#define FLIGHT_RECORDER_SIZE 64              // 环形缓冲事件数（必须是 2 的幂）
+#define FLIGHT_RECORDER_MAGIC 0x46524532     // "FRE2"（事件结构变化时更换，使旧布局失效）
+#define FLIGHT_HANDLER_THRESHOLD_US 1000     // 超过该耗时的回调才记录
+
+// ========================
+// 事件类型
+// ========================
+enum FlightEventType : uint8_t {
+  FR_EVT_BOOT = 1,          // value = 复位原因
+  FR_EVT_CONNECT_ATTEMPT,   // value = 0
+  FR_EVT_CONNECT_OK,        // value = 连接耗时（毫秒）
+  FR_EVT_CONNECT_FAIL,      // value = PubSubClient state()
+  FR_EVT_PUBLISH_FAIL,      // value = 消息长度
+  FR_EVT_HANDLER_TIME,      // value = 回调耗时（微秒）
+  FR_EVT_HEAP_LOW           // value = 堆最低水位（字节）
+};
+
+// ========================
+// 事件结构体（16 字节）
+// ========================
+struct FlightEvent {
+  uint64_t timestampUs;     // 本次启动以来的微秒数（64 位，长时间运行不回绕）
+  uint16_t bootSeq;         // 启动序号
+  uint8_t type;             // FlightEventType
+  uint8_t reserved;
+  uint32_t value;
+};
+
+// ========================
+// RTC 慢速内存中的环形缓冲
+// ========================
+struct FlightRecorderRing {
+  uint32_t magic;
+  uint16_t bootSeq;
+  uint16_t head;            // 下一个写入位置
+  uint16_t count;           // 有效事件数
+  uint16_t reserved;
+  FlightEvent events[FLIGHT_RECORDER_SIZE];
+};
+
+RTC_NOINIT_ATTR FlightRecorderRing flightRing;
+
+// 上次启动遗留的事件（启动时从 RTC 内存拷出）
+std::vector<FlightEvent> recoveredFlightEvents;
+uint32_t recoveredResetReason = 0;
+uint32_t flightHeapLowWater = 0xFFFFFFFF;
+bool flightRecorderStarted = false;
+
+inline uint64_t flightNowUs() {
+  #ifdef ESP32
+    return (uint64_t)esp_timer_get_time();
+  #else
+    return (uint64_t)micros();
+  #endif
+}
+
+// ========================
+// 记录事件（热路径，只做几次存储）
+// ========================
+inline void flightRecord(uint8_t type, uint32_t value = 0) {
+  FlightEvent& e = flightRing.events[flightRing.head];
+  e.timestampUs = flightNowUs();
+  e.bootSeq = flightRing.bootSeq;
+  e.type = type;
+  e.value = value;
+  flightRing.head = (flightRing.head + 1) & (FLIGHT_RECORDER_SIZE - 1);
+  if (flightRing.count < FLIGHT_RECORDER_SIZE) flightRing.count++;
+}
+
+// ========================
+// 记录堆最低水位（只在创新低时写入）
+// ========================
+inline void flightRecordHeapLowWater() {
+  #ifdef ESP32
+    uint32_t low = ESP.getMinFreeHeap();
+  #else
+    uint32_t low = ESP.getFreeHeap();
+  #endif
+  if (low < flightHeapLowWater) {
+    flightHeapLowWater = low;
+    flightRecord(FR_EVT_HEAP_LOW, low);
+  }
+}
+
+// ========================
+// 初始化：恢复上次启动的记录并开始新会话
+// ========================
+void flightRecorderBegin() {
+  if (flightRecorderStarted) return;
+  flightRecorderStarted = true;
+
+  uint32_t resetReason = 0;
+  #ifdef ESP32
+    resetReason = (uint32_t)esp_reset_reason();
+  #endif
+
+  bool valid = flightRing.magic == FLIGHT_RECORDER_MAGIC &&
+               flightRing.head < FLIGHT_RECORDER_SIZE &&
+               flightRing.count <= FLIGHT_RECORDER_SIZE;
+  #ifdef ESP32
+    // 上电复位时 RTC 内存内容是随机的
+    if (resetReason == ESP_RST_POWERON) valid = false;
+  #endif
+
+  recoveredFlightEvents.clear();
+  if (valid && flightRing.count > 0) {
+    recoveredFlightEvents.reserve(flightRing.count);
+    uint16_t start = (flightRing.head - flightRing.count) & (FLIGHT_RECORDER_SIZE - 1);
+    for (uint16_t i = 0; i < flightRing.count; i++) {
+      recoveredFlightEvents.push_back(flightRing.events[(start + i) & (FLIGHT_RECORDER_SIZE - 1)]);
+    }
+    recoveredResetReason = resetReason;
+  }
+
+  flightRing.bootSeq = valid ? flightRing.bootSeq + 1 : 0;
+  flightRing.magic = FLIGHT_RECORDER_MAGIC;
+  flightRing.head = 0;
+  flightRing.count = 0;
+
+  flightRecord(FR_EVT_BOOT, resetReason);
+}
+
+// ========================
+// 事件类型名称
+// ========================
+const char* flightEventName(uint8_t type) {
+  switch (type) {
+    case FR_EVT_BOOT:            return "boot";
+    case FR_EVT_CONNECT_ATTEMPT: return "connect";
+    case FR_EVT_CONNECT_OK:      return "connect_ok";
+    case FR_EVT_CONNECT_FAIL:    return "connect_fail";
+    case FR_EVT_PUBLISH_FAIL:    return "publish_fail";
+    case FR_EVT_HANDLER_TIME:    return "handler_us";
+    case FR_EVT_HEAP_LOW:        return "heap_low";
+    default:                     return "unknown";
+  }
+}
+
+#endif
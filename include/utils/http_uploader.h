@@ -0,0 +1,379 @@
+// include/http_uploader.h
+#ifndef HTTP_UPLOADER_H
+#define HTTP_UPLOADER_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "mpsc_queue.h"
+#include "psram_policy.h"
+
+#ifndef ARDUINO
+  #include <thread>
+#endif
+
+#define HTTP_UPLOAD_QUEUE 8               // 待上传任务数（2 的幂）
+#define HTTP_UPLOAD_CHUNK 4096            // 每个 HTTP chunk 的大小
+#define HTTP_UPLOAD_TIMEOUT_MS 10000
+
+// 内存中的上传数据（大块帧数据，按 BUF_FRAME 策略放置）
+typedef std::vector<uint8_t, PolicyAllocator<uint8_t, BUF_FRAME> > UploadBuffer;
+
+// 流式数据源：写入 buf 返回字节数，0 表示结束，负数表示出错
+typedef std::function<int(uint8_t* buf, size_t maxLen)> UploadReader;
+
+// ========================
+// 上传任务 / 结果
+// ========================
+struct UploadJob {
+  uint32_t id;
+  String path;                    // 追加在端点路径之后
+  String contentType;
+  UploadBuffer data;              // 内存中的数据，或
+  UploadReader reader;            // 流式读取（如从 SD 卡逐块读）
+  uint32_t enqueuedAt;
+};
+
+struct UploadResult {
+  uint32_t id;
+  int status;                     // HTTP 状态码，负数为连接 / 传输错误
+  uint32_t bytes;
+  uint32_t durationMs;            // 实际传输耗时
+  uint32_t queuedMs;              // 排队等待时间
+  char path[48];
+};
+
+typedef std::function<void(const UploadResult& result)> UploadResultHandler;
+
+// ========================
+// HTTP 分块上传
+// 大块数据在独立任务中以 Transfer-Encoding: chunked 的 POST 上传，
+// 采集方只需入队后继续工作（采集与上传流水线并行）；
+// 结果经无锁队列回到调用 poll() 的任务，再由 MQTT 发出通知
+// ========================
+class HttpUploader {
+private:
+  Client& client;                 // 只在上传任务中使用
+  String host;
+  uint16_t port;
+  String basePath;
+  MpscQueue<UploadJob*, HTTP_UPLOAD_QUEUE> jobs;
+  MpscQueue<UploadResult, HTTP_UPLOAD_QUEUE> results;
+  std::vector<uint8_t, PolicyAllocator<uint8_t, BUF_NETWORK> > chunk;
+  std::atomic<bool> running;
+  std::atomic<bool> taskDone;
+  std::atomic<uint32_t> inFlight;
+  std::atomic<uint32_t> nextId;   // enqueue 可在多个任务中调用
+  uint32_t reportedDrops;         // 已输出日志的结果丢弃数
+  UploadResultHandler handler;
+  #ifndef ARDUINO
+    std::thread worker;
+  #endif
+
+public:
+  HttpUploader(Client& transport) : client(transport) {
+    port = 80;
+    running = false;
+    taskDone = true;
+    inFlight = 0;
+    nextId = 1;
+    reportedDrops = 0;
+  }
+
+  ~HttpUploader() {
+    stop();
+  }
+
+  // ========================
+  // 设置端点，如 http://192.168.1.10:8080/upload
+  // HTTPS 端点需传入 WiFiClientSecure 之类的 TLS Client
+  // ========================
+  bool setEndpoint(const char* url) {
+    String u(url);
+    int scheme = u.indexOf("://");
+    String rest = scheme >= 0 ? u.substring(scheme + 3) : u;
+    port = u.startsWith("https://") ? 443 : 80;
+
+    int slash = rest.indexOf('/');
+    String hostPort = slash >= 0 ? rest.substring(0, slash) : rest;
+    basePath = slash >= 0 ? rest.substring(slash) : String("/");
+
+    int colon = hostPort.indexOf(':');
+    if (colon >= 0) {
+      host = hostPort.substring(0, colon);
+      port = (uint16_t)hostPort.substring(colon + 1).toInt();
+    } else {
+      host = hostPort;
+    }
+    if (basePath.endsWith("/")) basePath = basePath.substring(0, basePath.length() - 1);
+    return host.length() > 0 && port != 0;
+  }
+
+  void setResultHandler(UploadResultHandler resultHandler) {
+    handler = resultHandler;
+  }
+
+  // ========================
+  // 启动上传任务（不绑定核心，优先级低于采集任务）
+  // ========================
+  bool start(uint8_t taskPriority = 2) {
+    if (running) return true;
+    chunk.resize(HTTP_UPLOAD_CHUNK + 16);
+    running = true;
+    taskDone = false;
+
+    #ifdef ARDUINO
+      if (xTaskCreatePinnedToCore(uploadTask, "http_upload", 6144, this, taskPriority, nullptr, tskNO_AFFINITY) != pdPASS) {
+        running = false;
+        taskDone = true;
+        Serial.println("✗ Upload task create failed");
+        return false;
+      }
+    #else
+      (void)taskPriority;
+      worker = std::thread(uploadTask, this);
+    #endif
+    return true;
+  }
+
+  // 停止上传任务，丢弃尚未上传的任务
+  void stop() {
+    if (running) {
+      running = false;
+      #ifdef ARDUINO
+        while (!taskDone) delay(1);
+      #else
+        if (worker.joinable()) worker.join();
+      #endif
+    }
+
+    // 上传任务已退出，此处是唯一的消费者
+    UploadJob* job;
+    while (jobs.tryPop(job)) {
+      delete job;
+      inFlight--;
+    }
+  }
+
+  // ========================
+  // 入队（数据移交给上传任务），队列满时返回 0
+  // ========================
+  uint32_t enqueue(const char* path, const char* contentType, UploadBuffer&& data) {
+    UploadJob* job = newJob(path, contentType);
+    job->data.swap(data);
+    return submit(job);
+  }
+
+  uint32_t enqueueStream(const char* path, const char* contentType, UploadReader reader) {
+    UploadJob* job = newJob(path, contentType);
+    job->reader = reader;
+    return submit(job);
+  }
+
+  // 排队中和正在上传的任务数
+  uint32_t pending() {
+    return inFlight;
+  }
+
+  // ========================
+  // 分发上传结果（在 loop 中调用）
+  // ========================
+  void poll() {
+    UploadResult r;
+    while (results.tryPop(r)) {
+      if (handler) handler(r);
+    }
+
+    // 结果队列满时上传任务丢弃结果（上传本身已完成），这里输出日志
+    uint32_t drops = results.droppedCount();
+    if (drops != reportedDrops) {
+      Serial.printf("⚠ %u upload results dropped (poll() not called often enough)\n", (unsigned)(drops - reportedDrops));
+      reportedDrops = drops;
+    }
+  }
+
+  // 因结果队列满而丢弃的上传结果数
+  uint32_t getDroppedResultCount() {
+    return results.droppedCount();
+  }
+
+  // ========================
+  // 同步上传一个任务（上传任务中调用，也可在没有任务时直接使用）
+  // ========================
+  UploadResult upload(UploadJob& job) {
+    UploadResult r;
+    memset(&r, 0, sizeof(r));
+    r.id = job.id;
+    strncpy(r.path, job.path.c_str(), sizeof(r.path) - 1);
+    r.queuedMs = millis() - job.enqueuedAt;
+
+    uint32_t start = millis();
+    r.status = send(job, r.bytes);
+    // 复用的长连接可能已被服务器关闭，重连后重试一次（流式数据无法重放）
+    if (r.status == -2 && !job.reader) {
+      client.stop();
+      r.bytes = 0;
+      r.status = send(job, r.bytes);
+    }
+    r.durationMs = millis() - start;
+    return r;
+  }
+
+private:
+  UploadJob* newJob(const char* path, const char* contentType) {
+    UploadJob* job = new UploadJob();
+    job->id = nextId++;
+    if (job->id == 0) job->id = nextId++;   // 0 表示入队失败
+    job->path = String(path);
+    job->contentType = String(contentType);
+    job->enqueuedAt = millis();
+    return job;
+  }
+
+  uint32_t submit(UploadJob* job) {
+    uint32_t id = job->id;
+    if (!jobs.tryPush(job)) {
+      delete job;
+      return 0;
+    }
+    inFlight++;
+    return id;
+  }
+
+  static void uploadTask(void* arg) {
+    HttpUploader* self = static_cast<HttpUploader*>(arg);
+    while (self->running) {
+      UploadJob* job;
+      if (!self->jobs.tryPop(job)) {
+        delay(5);
+        continue;
+      }
+      UploadResult r = self->upload(*job);
+      delete job;
+      self->results.tryPush(r);
+      self->inFlight--;
+    }
+    self->client.stop();
+    self->taskDone = true;
+    #ifdef ARDUINO
+      vTaskDelete(nullptr);
+    #endif
+  }
+
+  // ========================
+  // 发送请求，返回 HTTP 状态码（-1 连接失败，-2 写入失败，-3 响应超时，-4 数据源错误）
+  // ========================
+  int send(UploadJob& job, uint32_t& bytes) {
+    if (!client.connected() && !client.connect(host.c_str(), port)) {
+      return -1;
+    }
+
+    String head = "POST " + basePath + (job.path.startsWith("/") ? "" : "/") + job.path + " HTTP/1.1\r\n" +
+                  "Host: " + host + "\r\n" +
+                  "Content-Type: " + job.contentType + "\r\n" +
+                  "Transfer-Encoding: chunked\r\n" +
+                  "Connection: keep-alive\r\n\r\n";
+    if (!writeAll((const uint8_t*)head.c_str(), head.length())) return -2;
+
+    size_t offset = 0;
+    for (;;) {
+      // 预留 chunk 头部空间，整块一次写出
+      uint8_t* body = chunk.data() + 8;
+      int n;
+      if (job.reader) {
+        n = job.reader(body, HTTP_UPLOAD_CHUNK);
+        if (n < 0) {
+          client.stop();
+          return -4;
+        }
+      } else {
+        n = (int)std::min((size_t)HTTP_UPLOAD_CHUNK, job.data.size() - offset);
+        memcpy(body, job.data.data() + offset, n);
+        offset += n;
+      }
+
+      char size[8];
+      int len = snprintf(size, sizeof(size), "%X\r\n", n);
+      uint8_t* frame = body - len;
+      memcpy(frame, size, len);
+      body[n] = '\r';
+      body[n + 1] = '\n';
+      if (!writeAll(frame, len + n + 2)) return -2;
+      bytes += n;
+
+      if (n == 0) break;          // "0\r\n\r\n" 结束
+    }
+
+    return readResponse();
+  }
+
+  bool writeAll(const uint8_t* data, size_t length) {
+    uint32_t start = millis();
+    while (length > 0) {
+      size_t n = client.write(data, length);
+      if (n == 0) {
+        if (!client.connected() || millis() - start > HTTP_UPLOAD_TIMEOUT_MS) return false;
+        delay(1);
+        continue;
+      }
+      data += n;
+      length -= n;
+    }
+    return true;
+  }
+
+  // 读取状态行和头部，跳过 Content-Length 指定的响应体以便复用连接
+  int readResponse() {
+    String line;
+    int status = -3;
+    int contentLength = -1;
+    bool statusRead = false;
+    uint32_t start = millis();
+
+    while (millis() - start < HTTP_UPLOAD_TIMEOUT_MS) {
+      if (client.available() <= 0) {
+        if (!client.connected()) break;
+        delay(1);
+        continue;
+      }
+      char c = (char)client.read();
+      if (c == '\r') continue;
+      if (c != '\n') {
+        line += c;
+        continue;
+      }
+
+      if (!statusRead) {
+        int sp = line.indexOf(' ');
+        status = sp > 0 ? line.substring(sp + 1, sp + 4).toInt() : -3;
+        statusRead = true;
+      } else if (line.length() == 0) {
+        break;                    // 头部结束
+      } else if (line.startsWith("Content-Length:") || line.startsWith("content-length:")) {
+        contentLength = line.substring(15).toInt();
+      }
+      line = "";
+    }
+
+    if (contentLength < 0) {
+      client.stop();              // 无法确定响应体长度，不复用连接
+    } else {
+      while (contentLength > 0 && millis() - start < HTTP_UPLOAD_TIMEOUT_MS) {
+        if (client.available() > 0) {
+          client.read();
+          contentLength--;
+        } else if (!client.connected()) {
+          break;
+        } else {
+          delay(1);
+        }
+      }
+    }
+    return status;
+  }
+};
+
+#endif
@@ -0,0 +1,422 @@
+// include/impaired_client.h
+#ifndef IMPAIRED_CLIENT_H
+#define IMPAIRED_CLIENT_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <PubSubClient.h>
+#include <deque>
+#include <vector>
+
+#define IMPAIR_STALL_TICK_MS 100        // 停顿按经过的时间分片掷骰，与 pump() 的调用频率无关
+
+// ========================
+// 网络损伤参数
+// ========================
+struct NetImpairment {
+  uint32_t latencyMs;             // 单向固定延迟
+  uint32_t jitterMs;              // 额外随机延迟 [0, jitterMs]
+  uint32_t bandwidthBps;          // 每个方向的带宽上限（字节/秒，0 表示不限）
+  uint16_t stallPermille;         // 每秒触发停顿的概率（‰）
+  uint32_t stallMs;               // 停顿时长
+  uint16_t disconnectPermille;    // 每次写入触发断线的概率（‰）
+  uint32_t disconnectAfterMs;     // 连接建立后多久强制断线（0 表示不断）
+  uint32_t seed;                  // 随机种子（便于复现）
+};
+
+// ========================
+// 损伤统计
+// ========================
+struct ImpairmentStats {
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+  uint32_t stalls;
+  uint32_t disconnects;
+};
+
+// ========================
+// 网络损伤模拟 Client
+// 包装一个真实 Client（如 PosixSocketClient），在两个方向上注入
+// 延迟、抖动、带宽限制、停顿和突然断线，用于测试重连、排队和退避
+// ========================
+class ImpairedClient : public Client {
+private:
+  struct Chunk {
+    uint32_t releaseAt;           // 可交付时间（millis）
+    std::vector<uint8_t> data;
+    size_t offset;
+  };
+
+  struct Direction {
+    std::deque<Chunk> line;       // 延迟线
+    uint32_t lastRelease;         // 保证顺序：交付时间单调递增
+    float tokens;                 // 令牌桶（字节）
+    uint32_t lastRefill;
+  };
+
+  Client& inner;
+  NetImpairment config;
+  ImpairmentStats stats;
+  Direction outbound;
+  Direction inbound;
+  uint32_t stalledUntil;
+  uint32_t lastStallRoll;         // 上次掷骰对应的时间片起点
+  uint32_t connectedAt;
+  uint32_t rng;
+  bool dropped;                   // 已模拟断线
+
+public:
+  ImpairedClient(Client& client, const NetImpairment& impairment) : inner(client) {
+    setImpairment(impairment);
+    resetStats();
+    resetLink();
+  }
+
+  void setImpairment(const NetImpairment& impairment) {
+    config = impairment;
+    rng = impairment.seed ? impairment.seed : 0x9E3779B9;
+  }
+
+  // 统计跨重连累计，需要时显式清零
+  const ImpairmentStats& getStats() {
+    return stats;
+  }
+
+  void resetStats() {
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  // ========================
+  // 立即模拟一次断线
+  // ========================
+  void forceDisconnect() {
+    stats.disconnects++;
+    dropped = true;
+    inner.stop();
+    outbound.line.clear();
+    inbound.line.clear();
+  }
+
+  int connect(IPAddress ip, uint16_t port) override {
+    resetLink();
+    delayConnect();
+    return inner.connect(ip, port);
+  }
+
+  int connect(const char* host, uint16_t port) override {
+    resetLink();
+    delayConnect();
+    return inner.connect(host, port);
+  }
+
+  size_t write(uint8_t b) override {
+    return write(&b, 1);
+  }
+
+  size_t write(const uint8_t* buf, size_t size) override {
+    pump();
+    if (dropped) return 0;
+
+    if (chance(config.disconnectPermille)) {
+      forceDisconnect();
+      return 0;
+    }
+
+    Chunk chunk;
+    chunk.releaseAt = nextRelease(outbound);
+    chunk.data.assign(buf, buf + size);
+    chunk.offset = 0;
+    outbound.line.push_back(chunk);
+    pump();
+    return size;
+  }
+
+  int available() override {
+    pump();
+    return (int)deliverable(inbound);
+  }
+
+  int read() override {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+  }
+
+  int read(uint8_t* buf, size_t size) override {
+    pump();
+    size_t n = 0;
+    uint32_t now = millis();
+    while (n < size && !inbound.line.empty()) {
+      Chunk& c = inbound.line.front();
+      if ((int32_t)(now - c.releaseAt) < 0) break;
+      size_t take = c.data.size() - c.offset;
+      if (take > size - n) take = size - n;
+      memcpy(buf + n, c.data.data() + c.offset, take);
+      c.offset += take;
+      n += take;
+      if (c.offset == c.data.size()) inbound.line.pop_front();
+    }
+    stats.bytesReceived += n;
+    return n > 0 ? (int)n : -1;
+  }
+
+  int peek() override {
+    pump();
+    if (inbound.line.empty()) return -1;
+    Chunk& c = inbound.line.front();
+    if ((int32_t)(millis() - c.releaseAt) < 0) return -1;
+    return c.data[c.offset];
+  }
+
+  void flush() override {
+    pump();
+  }
+
+  void stop() override {
+    inner.stop();
+    outbound.line.clear();
+    inbound.line.clear();
+  }
+
+  uint8_t connected() override {
+    pump();
+    if (dropped) return 0;
+    // 对端已关闭但延迟线中仍有数据时保持连接，直到数据交付完
+    return inner.connected() || !inbound.line.empty();
+  }
+
+  operator bool() override {
+    return !dropped && (bool)inner;
+  }
+
+private:
+  // 新连接只重置链路状态，统计保留
+  void resetLink() {
+    outbound = Direction{};
+    inbound = Direction{};
+    outbound.lastRefill = inbound.lastRefill = millis();
+    stalledUntil = 0;
+    lastStallRoll = millis();
+    connectedAt = millis();
+    dropped = false;
+  }
+
+  // 连接握手按一个往返的延迟计算
+  void delayConnect() {
+    uint32_t rtt = 2 * config.latencyMs + randomBelow(config.jitterMs + 1);
+    if (rtt > 0) delay(rtt);
+    connectedAt = millis();
+  }
+
+  // ========================
+  // 推进两个方向的延迟线
+  // ========================
+  void pump() {
+    if (dropped) return;
+    uint32_t now = millis();
+
+    if (config.disconnectAfterMs > 0 && (now - connectedAt) >= config.disconnectAfterMs) {
+      forceDisconnect();
+      return;
+    }
+
+    if ((int32_t)(now - stalledUntil) < 0) {
+      return;
+    }
+    if (rollStall(now)) {
+      stats.stalls++;
+      stalledUntil = now + config.stallMs;
+      lastStallRoll = stalledUntil;
+      return;
+    }
+
+    // 从真实连接读取，放入接收延迟线
+    int avail = inner.available();
+    if (avail > 0) {
+      size_t budget = takeTokens(inbound, avail);
+      if (budget > 0) {
+        Chunk chunk;
+        chunk.data.resize(budget);
+        int n = inner.read(chunk.data.data(), budget);
+        if (n > 0) {
+          chunk.data.resize(n);
+          chunk.offset = 0;
+          chunk.releaseAt = nextRelease(inbound);
+          inbound.line.push_back(chunk);
+        }
+      }
+    }
+
+    // 把到期的发送数据写入真实连接
+    while (!outbound.line.empty()) {
+      Chunk& c = outbound.line.front();
+      if ((int32_t)(now - c.releaseAt) < 0) break;
+      size_t budget = takeTokens(outbound, c.data.size() - c.offset);
+      if (budget == 0) break;
+      size_t written = inner.write(c.data.data() + c.offset, budget);
+      stats.bytesSent += written;
+      c.offset += written;
+      if (written < budget) break;
+      if (c.offset == c.data.size()) outbound.line.pop_front();
+    }
+  }
+
+  size_t deliverable(Direction& d) {
+    size_t total = 0;
+    uint32_t now = millis();
+    for (auto& c : d.line) {
+      if ((int32_t)(now - c.releaseAt) < 0) break;
+      total += c.data.size() - c.offset;
+    }
+    return total;
+  }
+
+  uint32_t nextRelease(Direction& d) {
+    uint32_t release = millis() + config.latencyMs + randomBelow(config.jitterMs + 1);
+    if ((int32_t)(release - d.lastRelease) < 0) release = d.lastRelease;
+    d.lastRelease = release;
+    return release;
+  }
+
+  // 令牌桶：返回本次允许传输的字节数
+  size_t takeTokens(Direction& d, size_t wanted) {
+    if (config.bandwidthBps == 0) return wanted;
+    uint32_t now = millis();
+    d.tokens += (now - d.lastRefill) * config.bandwidthBps / 1000.0f;
+    d.lastRefill = now;
+    float burst = config.bandwidthBps / 10.0f + 1;   // 最多积攒 100ms 的令牌
+    if (d.tokens > burst) d.tokens = burst;
+    size_t allowed = d.tokens >= wanted ? wanted : (size_t)d.tokens;
+    d.tokens -= allowed;
+    return allowed;
+  }
+
+  uint32_t nextRandom() {
+    // xorshift32
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+  }
+
+  uint32_t randomBelow(uint32_t bound) {
+    return bound > 1 ? nextRandom() % bound : 0;
+  }
+
+  bool chance(uint16_t permille) {
+    return permille > 0 && randomBelow(1000) < permille;
+  }
+
+  // 每个经过的时间片以 stallPermille / 10 的概率（‰）触发停顿，合计约为每秒 stallPermille
+  bool rollStall(uint32_t now) {
+    if (config.stallMs == 0 || config.stallPermille == 0) {
+      lastStallRoll = now;
+      return false;
+    }
+    uint32_t ticks = (now - lastStallRoll) / IMPAIR_STALL_TICK_MS;
+    lastStallRoll += ticks * IMPAIR_STALL_TICK_MS;
+    if (ticks > 1000 / IMPAIR_STALL_TICK_MS * 60) ticks = 1000 / IMPAIR_STALL_TICK_MS * 60;
+    for (uint32_t i = 0; i < ticks; i++) {
+      if (randomBelow(10000) < config.stallPermille) return true;
+    }
+    return false;
+  }
+};
+
+// ========================
+// 损伤网络下的 MQTT 基准
+// 经 ImpairedClient 用 PubSubClient 连接 broker，订阅一个专用主题并按固定间隔向它发布（QoS 0），
+// 统计发出 / 经 broker 回到本机的消息速率，以及每次断线到重新连上并订阅完成的耗时
+// （首次连接不计入重连）。断线由损伤参数 disconnectPermille / disconnectAfterMs 触发
+//
+//   PosixSocketClient socket;
+//   NetImpairment bad = {80, 40, 20000, 20, 500, 5, 15000, 1};
+//   ImpairedClient link(socket, bad);
+//   measureImpairedMqtt(link, "127.0.0.1", 1883, 60000);
+// ========================
+struct ImpairedMqttResult {
+  float sentPerSec;
+  float receivedPerSec;
+  uint32_t reconnects;
+  uint32_t avgReconnectMs;
+  uint32_t maxReconnectMs;
+  uint32_t failedConnects;        // 连接或订阅失败的尝试次数
+  ImpairmentStats link;
+};
+
+inline ImpairedMqttResult measureImpairedMqtt(ImpairedClient& client, const char* host, uint16_t port,
+                                              uint32_t durationMs = 30000, uint16_t payloadBytes = 64,
+                                              uint32_t publishIntervalMs = 10) {
+  ImpairedMqttResult result;
+  memset(&result, 0, sizeof(result));
+
+  // 回调不捕获状态（PubSubClient 在部分平台上只接受函数指针）
+  static uint32_t received;
+  received = 0;
+
+  PubSubClient mqtt(client);
+  mqtt.setServer(host, port);
+  mqtt.setBufferSize(payloadBytes + 128);
+  mqtt.setCallback([](char*, uint8_t*, unsigned int) {
+    received++;
+  });
+
+  String clientId = "impair-" + String((uint32_t)micros());
+  String topic = "bench/impair/" + clientId;
+  std::vector<uint8_t> payload(payloadBytes, 'x');
+
+  uint32_t sent = 0;
+  uint32_t totalReconnectMs = 0;
+  bool everConnected = false;
+  bool down = true;
+  uint32_t downSince = millis();
+  uint32_t lastPublish = 0;
+  uint32_t start = millis();
+
+  while (millis() - start < durationMs) {
+    if (!mqtt.connected()) {
+      if (!down) {
+        down = true;
+        downSince = millis();
+      }
+      if (!mqtt.connect(clientId.c_str()) || !mqtt.subscribe(topic.c_str())) {
+        result.failedConnects++;
+        delay(100);
+        continue;
+      }
+      if (everConnected) {
+        uint32_t took = millis() - downSince;
+        result.reconnects++;
+        totalReconnectMs += took;
+        if (took > result.maxReconnectMs) result.maxReconnectMs = took;
+      }
+      everConnected = true;
+      down = false;
+    }
+
+    mqtt.loop();
+    uint32_t now = millis();
+    if (now - lastPublish >= publishIntervalMs) {
+      lastPublish = now;
+      if (mqtt.publish(topic.c_str(), payload.data(), payload.size())) sent++;
+    }
+    delay(0);
+  }
+
+  uint32_t elapsed = millis() - start;
+  mqtt.disconnect();
+  if (elapsed == 0) elapsed = 1;
+  result.sentPerSec = sent * 1000.0f / elapsed;
+  result.receivedPerSec = received * 1000.0f / elapsed;
+  result.avgReconnectMs = result.reconnects ? totalReconnectMs / result.reconnects : 0;
+  result.link = client.getStats();
+
+  Serial.printf("Impaired MQTT: sent %.1f/s, received %.1f/s, reconnects %u (avg %u ms, max %u ms), failed %u\n",
+                result.sentPerSec, result.receivedPerSec, (unsigned)result.reconnects,
+                (unsigned)result.avgReconnectMs, (unsigned)result.maxReconnectMs, (unsigned)result.failedConnects);
+  Serial.printf("  link: %u B out, %u B in, %u stalls, %u disconnects\n",
+                (unsigned)result.link.bytesSent, (unsigned)result.link.bytesReceived,
+                (unsigned)result.link.stalls, (unsigned)result.link.disconnects);
+  return result;
+}
+
+#endif
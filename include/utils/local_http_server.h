@@ -0,0 +1,268 @@
+// include/local_http_server.h
+#ifndef LOCAL_HTTP_SERVER_H
+#define LOCAL_HTTP_SERVER_H
+
+// ========================
+// 主机构建使用的本地 HTTP 服务器
+// 作为 HttpUploader 的测试端点：接收 POST（chunked 或 Content-Length），
+// 保存请求内容供检查，按设置的状态码应答；配合 PosixSocketClient 使用
+// 仓库内没有主机构建环境，也没有使用它的测试，此文件未经编译测试
+//
+//   LocalHttpServer server;
+//   server.start();
+//   uploader.setEndpoint(server.url("/upload").c_str());
+// ========================
+#ifndef ARDUINO
+
+#include <Arduino.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define LOCAL_HTTP_READ_TIMEOUT_MS 2000
+
+// ========================
+// 收到的请求
+// ========================
+struct LocalHttpRequest {
+  std::string method;
+  std::string path;
+  std::string contentType;
+  bool chunked;
+  std::vector<uint8_t> body;
+};
+
+class LocalHttpServer {
+private:
+  // 带缓冲的连接读取
+  struct Connection {
+    int fd;
+    uint8_t buf[1024];
+    size_t pos;
+    size_t len;
+  };
+
+  int listenFd;
+  uint16_t boundPort;
+  std::atomic<bool> running;
+  std::atomic<int> responseStatus;
+  std::atomic<bool> closeAfterResponse;
+  std::atomic<uint32_t> connections;
+  std::mutex lock;
+  std::vector<LocalHttpRequest> received;
+  std::thread worker;
+
+public:
+  LocalHttpServer() : listenFd(-1), boundPort(0) {
+    running = false;
+    responseStatus = 200;
+    closeAfterResponse = false;
+    connections = 0;
+  }
+
+  ~LocalHttpServer() {
+    stop();
+  }
+
+  // ========================
+  // 在 127.0.0.1 上监听，port 为 0 时由系统分配；返回实际端口（0 表示失败）
+  // ========================
+  uint16_t start(uint16_t port = 0) {
+    if (running) return boundPort;
+
+    listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) return 0;
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    socklen_t addrLen = sizeof(addr);
+    if (::bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(listenFd, 4) != 0 ||
+        getsockname(listenFd, (struct sockaddr*)&addr, &addrLen) != 0) {
+      ::close(listenFd);
+      listenFd = -1;
+      return 0;
+    }
+
+    boundPort = ntohs(addr.sin_port);
+    running = true;
+    worker = std::thread(&LocalHttpServer::serve, this);
+    return boundPort;
+  }
+
+  void stop() {
+    if (!running) return;
+    running = false;
+    if (worker.joinable()) worker.join();
+    ::close(listenFd);
+    listenFd = -1;
+  }
+
+  String url(const char* path = "/upload") {
+    return String("http://127.0.0.1:") + String(boundPort) + path;
+  }
+
+  // 后续请求的应答状态码（如 500 用于测试失败通知）
+  void setResponseStatus(int status) {
+    responseStatus = status;
+  }
+
+  // 应答后关闭连接（用于测试客户端的重连重试）
+  void setCloseAfterResponse(bool close) {
+    closeAfterResponse = close;
+  }
+
+  size_t requestCount() {
+    std::lock_guard<std::mutex> guard(lock);
+    return received.size();
+  }
+
+  bool getRequest(size_t index, LocalHttpRequest& out) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (index >= received.size()) return false;
+    out = received[index];
+    return true;
+  }
+
+  // 已接受的连接数（长连接复用时不增加）
+  uint32_t connectionCount() {
+    return connections;
+  }
+
+private:
+  void serve() {
+    while (running) {
+      struct pollfd p = {listenFd, POLLIN, 0};
+      if (::poll(&p, 1, 50) <= 0) continue;
+      int fd = ::accept(listenFd, nullptr, nullptr);
+      if (fd < 0) continue;
+      connections++;
+
+      Connection conn;
+      conn.fd = fd;
+      conn.pos = 0;
+      conn.len = 0;
+      while (running && handleRequest(conn)) {
+        if (closeAfterResponse) break;
+      }
+      ::close(fd);
+    }
+  }
+
+  // ========================
+  // 处理一个请求，连接可继续复用时返回 true
+  // ========================
+  bool handleRequest(Connection& conn) {
+    LocalHttpRequest req;
+    req.chunked = false;
+    long contentLength = -1;
+
+    std::string line;
+    if (!readLine(conn, line) || line.empty()) return false;
+    size_t sp1 = line.find(' ');
+    size_t sp2 = line.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos) return false;
+    req.method = line.substr(0, sp1);
+    req.path = line.substr(sp1 + 1, sp2 - sp1 - 1);
+
+    // 头部（名称不区分大小写）
+    for (;;) {
+      if (!readLine(conn, line)) return false;
+      if (line.empty()) break;
+      size_t colon = line.find(':');
+      if (colon == std::string::npos) continue;
+      std::string name = line.substr(0, colon);
+      for (auto& c : name) c = (char)tolower((unsigned char)c);
+      size_t v = line.find_first_not_of(' ', colon + 1);
+      std::string value = v == std::string::npos ? "" : line.substr(v);
+      if (name == "content-type") req.contentType = value;
+      if (name == "content-length") contentLength = atol(value.c_str());
+      if (name == "transfer-encoding" && value.find("chunked") != std::string::npos) req.chunked = true;
+    }
+
+    if (req.chunked) {
+      for (;;) {
+        if (!readLine(conn, line)) return false;
+        size_t size = strtoul(line.c_str(), nullptr, 16);
+        if (size == 0) {
+          // 跳过 trailer，直到空行
+          do {
+            if (!readLine(conn, line)) return false;
+          } while (!line.empty());
+          break;
+        }
+        size_t offset = req.body.size();
+        req.body.resize(offset + size);
+        if (!readBytes(conn, req.body.data() + offset, size) || !readLine(conn, line)) return false;
+      }
+    } else if (contentLength > 0) {
+      req.body.resize(contentLength);
+      if (!readBytes(conn, req.body.data(), contentLength)) return false;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      received.push_back(req);
+    }
+
+    char response[128];
+    int len = snprintf(response, sizeof(response), "HTTP/1.1 %d %s\r\nContent-Length: 2\r\n%s\r\nok",
+                       (int)responseStatus, responseStatus == 200 ? "OK" : "Error",
+                       closeAfterResponse ? "Connection: close\r\n" : "");
+    return ::send(conn.fd, response, len, MSG_NOSIGNAL) == len;
+  }
+
+  bool fill(Connection& conn) {
+    uint32_t start = millis();
+    while (running && millis() - start < LOCAL_HTTP_READ_TIMEOUT_MS) {
+      struct pollfd p = {conn.fd, POLLIN, 0};
+      if (::poll(&p, 1, 20) <= 0) continue;
+      ssize_t n = ::recv(conn.fd, conn.buf, sizeof(conn.buf), 0);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      conn.pos = 0;
+      conn.len = n;
+      return true;
+    }
+    return false;
+  }
+
+  bool readLine(Connection& conn, std::string& line) {
+    line.clear();
+    for (;;) {
+      if (conn.pos == conn.len && !fill(conn)) return false;
+      char c = (char)conn.buf[conn.pos++];
+      if (c == '\n') return true;
+      if (c != '\r') line += c;
+    }
+  }
+
+  bool readBytes(Connection& conn, uint8_t* out, size_t length) {
+    while (length > 0) {
+      if (conn.pos == conn.len && !fill(conn)) return false;
+      size_t n = conn.len - conn.pos;
+      if (n > length) n = length;
+      memcpy(out, conn.buf + conn.pos, n);
+      conn.pos += n;
+      out += n;
+      length -= n;
+    }
+    return true;
+  }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+// include/message_arena.h
+#ifndef MESSAGE_ARENA_H
+#define MESSAGE_ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// ========================
+// 单条消息生命周期内的线性分配器
+// 分配只移动指针，释放是空操作，消息处理完后 reset() 一次性回收
+// ========================
+class MessageArena {
+private:
+  uint8_t* buffer;
+  size_t capacity;
+  size_t used;
+  size_t lastOffset;              // 最近一次分配的起点（用于原地扩展）
+  size_t highWater;               // 历史最高使用量
+  uint32_t failures;              // 空间不足次数
+
+public:
+  MessageArena(uint8_t* storage, size_t size) {
+    buffer = storage;
+    capacity = size;
+    used = 0;
+    lastOffset = 0;
+    highWater = 0;
+    failures = 0;
+  }
+
+  // ========================
+  // 分配（8 字节对齐），空间不足返回 nullptr
+  // ========================
+  void* allocate(size_t size) {
+    size_t offset = (used + 7) & ~(size_t)7;
+    if (offset + size > capacity) {
+      failures++;
+      return nullptr;
+    }
+    lastOffset = offset;
+    used = offset + size;
+    if (used > highWater) highWater = used;
+    return buffer + offset;
+  }
+
+  // ========================
+  // 只有最近一次分配可以原地调整大小
+  // ========================
+  void* reallocate(void* ptr, size_t size) {
+    if (ptr == nullptr) {
+      return allocate(size);
+    }
+    if (ptr != buffer + lastOffset || lastOffset + size > capacity) {
+      failures++;
+      return nullptr;
+    }
+    used = lastOffset + size;
+    if (used > highWater) highWater = used;
+    return ptr;
+  }
+
+  // ========================
+  // O(1) 回收全部内存
+  // ========================
+  void reset() {
+    used = 0;
+    lastOffset = 0;
+  }
+
+  size_t getUsed() { return used; }
+  size_t getCapacity() { return capacity; }
+  size_t getHighWater() { return highWater; }
+  uint32_t getFailures() { return failures; }
+};
+
+// ========================
+// ArduinoJson 分配器适配
+// ========================
+struct ArenaJsonAllocator {
+  MessageArena* arena;
+
+  ArenaJsonAllocator(MessageArena* a = nullptr) : arena(a) {}
+
+  void* allocate(size_t size) {
+    return arena ? arena->allocate(size) : nullptr;
+  }
+
+  void deallocate(void*) {
+  }
+
+  void* reallocate(void* ptr, size_t size) {
+    return arena ? arena->reallocate(ptr, size) : nullptr;
+  }
+};
+
+typedef BasicJsonDocument<ArenaJsonAllocator> ArenaJsonDocument;
+
+#endif
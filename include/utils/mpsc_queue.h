@@ -0,0 +1,230 @@
+// include/mpsc_queue.h
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#ifdef ESP32
+  #include <esp_attr.h>
+#endif
+#ifndef IRAM_ATTR
+  #define IRAM_ATTR
+#endif
+
+// ========================
+// 有界无锁多生产者单消费者队列
+// 每个槽位带序号（Vyukov 算法），生产者只做一次 CAS，不加锁、不分配内存，
+// 可在任意 FreeRTOS 任务和定时器回调中调用 tryPush / tryPushWith；
+// 中断中使用 tryReserve / slotAt / commit（位于 IRAM，flash 缓存关闭时也可执行）。
+// N 必须是 2 的幂。
+// ========================
+template <typename T, size_t N>
+class MpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "MpscQueue size must be a power of two");
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  Cell cells[N];
+  std::atomic<size_t> enqueuePos;
+  size_t dequeuePos;                // 只有消费者访问
+  std::atomic<uint32_t> dropped;    // 队列满时丢弃的数量
+
+public:
+  MpscQueue() {
+    for (size_t i = 0; i < N; i++) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos = 0;
+    dropped.store(0, std::memory_order_relaxed);
+  }
+
+  // ========================
+  // 生产者：预留槽位（满时返回 false），写入 slotAt(pos) 后调用 commit(pos) 发布
+  // ========================
+  bool IRAM_ATTR tryReserve(size_t& pos) {
+    pos = enqueuePos.load(std::memory_order_relaxed);
+
+    for (;;) {
+      Cell* cell = &cells[pos & (N - 1)];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+      if (diff == 0) {
+        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          return true;
+        }
+      } else if (diff < 0) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  T& IRAM_ATTR slotAt(size_t pos) {
+    return cells[pos & (N - 1)].data;
+  }
+
+  void IRAM_ATTR commit(size_t pos) {
+    cells[pos & (N - 1)].sequence.store(pos + 1, std::memory_order_release);
+  }
+
+  // 预留槽位，由 fill 填充数据后发布（满时返回 false）
+  template <typename Fill>
+  bool tryPushWith(Fill fill) {
+    size_t pos;
+    if (!tryReserve(pos)) return false;
+    fill(slotAt(pos));
+    commit(pos);
+    return true;
+  }
+
+  bool tryPush(const T& item) {
+    return tryPushWith([&item](T& slot) { slot = item; });
+  }
+
+  // ========================
+  // 消费者：取出一个元素（空时返回 false）
+  // ========================
+  bool tryPop(T& out) {
+    Cell* cell = &cells[dequeuePos & (N - 1)];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+
+    if ((intptr_t)seq - (intptr_t)(dequeuePos + 1) < 0) {
+      return false;
+    }
+
+    out = cell->data;
+    cell->sequence.store(dequeuePos + N, std::memory_order_release);
+    dequeuePos++;
+    return true;
+  }
+
+  uint32_t droppedCount() const {
+    return dropped.load(std::memory_order_relaxed);
+  }
+
+  size_t capacity() const {
+    return N;
+  }
+};
+
+// ========================
+// 争用基准：producers 个 std::thread 生产者 + 1 个消费者（调用方线程），
+// 分别测量无锁队列和 std::mutex 保护的同容量环形缓冲，返回每秒传递的元素数。
+// 队列满时生产者让出 CPU 后重试，重试次数计入 fullRetries；同时检查每个生产者的元素按顺序到达。
+// ESP32 上 std::thread 基于 pthread（FreeRTOS 任务），主机和设备都可以运行
+// ========================
+struct MpscContention {
+  float lockFreePerSec;
+  float mutexPerSec;
+  uint32_t lockFreeFullRetries;
+  uint32_t mutexFullRetries;
+  bool ordered;                     // 所有生产者的元素均按发送顺序到达
+};
+
+// 互斥锁保护的环形缓冲（基准对照）
+template <typename T, size_t N>
+class MutexRing {
+private:
+  T items[N];
+  size_t head;
+  size_t count;
+  std::mutex lock;
+
+public:
+  MutexRing() : head(0), count(0) {}
+
+  bool tryPush(const T& item) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (count == N) return false;
+    items[(head + count) % N] = item;
+    count++;
+    return true;
+  }
+
+  bool tryPop(T& out) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (count == 0) return false;
+    out = items[head];
+    head = (head + 1) % N;
+    count--;
+    return true;
+  }
+};
+
+// 元素编码：高 8 位为生产者编号，低 24 位为序号
+template <typename Queue>
+inline float runMpscContention(Queue& queue, uint8_t producers, uint32_t itemsPerProducer,
+                               uint32_t& fullRetries, bool& ordered) {
+  std::atomic<uint32_t> retries(0);
+  std::vector<std::thread> threads;
+  std::vector<uint32_t> expected(producers, 0);
+  uint64_t total = (uint64_t)producers * itemsPerProducer;
+
+  uint32_t start = micros();
+  for (uint8_t p = 0; p < producers; p++) {
+    threads.emplace_back([&queue, &retries, p, itemsPerProducer]() {
+      for (uint32_t i = 0; i < itemsPerProducer; i++) {
+        uint32_t item = ((uint32_t)p << 24) | (i & 0xFFFFFF);
+        while (!queue.tryPush(item)) {
+          retries.fetch_add(1, std::memory_order_relaxed);
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  uint64_t received = 0;
+  while (received < total) {
+    uint32_t item;
+    if (!queue.tryPop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    uint8_t p = item >> 24;
+    if (p >= producers || (item & 0xFFFFFF) != (expected[p] & 0xFFFFFF)) ordered = false;
+    if (p < producers) expected[p]++;
+    received++;
+  }
+  uint32_t elapsed = micros() - start;
+  for (auto& t : threads) t.join();
+
+  fullRetries = retries.load();
+  return total * 1000000.0f / (elapsed > 0 ? elapsed : 1);
+}
+
+template <size_t N = 256>
+inline MpscContention measureMpscContention(uint8_t producers = 4, uint32_t itemsPerProducer = 50000) {
+  MpscContention result = {0, 0, 0, 0, true};
+  if (producers == 0) producers = 1;
+
+  MpscQueue<uint32_t, N>* lockFree = new MpscQueue<uint32_t, N>();
+  result.lockFreePerSec = runMpscContention(*lockFree, producers, itemsPerProducer,
+                                            result.lockFreeFullRetries, result.ordered);
+  delete lockFree;
+
+  MutexRing<uint32_t, N>* locked = new MutexRing<uint32_t, N>();
+  result.mutexPerSec = runMpscContention(*locked, producers, itemsPerProducer,
+                                         result.mutexFullRetries, result.ordered);
+  delete locked;
+
+  Serial.printf("MPSC %u producers: lock-free %.0f/s (full %u), mutex %.0f/s (full %u)%s\n",
+                (unsigned)producers, result.lockFreePerSec, (unsigned)result.lockFreeFullRetries,
+                result.mutexPerSec, (unsigned)result.mutexFullRetries, result.ordered ? "" : " ✗ out of order");
+  return result;
+}
+
+#endif
@@ -0,0 +1,377 @@
+// include/mqtt_async.h
+#ifndef MQTT_ASYNC_H
+#define MQTT_ASYNC_H
+
+// ========================
+// 异步 MQTT 接口（单线程执行器 + 完成回调）
+//
+//   mqttAsync.connectAsync([](bool ok) { ... });
+//   mqttAsync.publishAsync("led/ack", "{\"ok\":true}", [](bool acked) { ... });
+//   mqttAsync.nextCommandAsync("led", 0, [](const AsyncCommand& cmd) { ... });
+//   mqttAsync.loop();                  // loop()，代替 mqttManager.loop()
+//
+// 回调只在 loop() 中调用，不会在 MQTT 回调或其他任务中执行。
+// 回调接口不依赖编译器版本（ESP32 Arduino 2.x / GCC 8 可用）。
+//
+// 编译器支持协程时（GCC 10+，-std=gnu++20），额外提供等价的协程写法；
+// 设备端用 platformio.ini 的 esp32cam_coroutines 环境构建（Arduino-ESP32 3.x / GCC 12）：
+//
+//   AsyncTask app(MQTTAsync& mq) {
+//     while (!co_await mq.connect()) co_await mq.sleep(5000);
+//     for (;;) {
+//       AsyncCommand cmd = co_await mq.nextCommand("led");
+//       co_await mq.publish("led/ack", cmd.command.c_str());
+//     }
+//   }
+//
+//   mqttAsync.spawn(app(mqttAsync));   // setup()
+// ========================
+
+#include <Arduino.h>
+#include <deque>
+#include <functional>
+#include <vector>
+#include "mqtt_manager.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+  #include <coroutine>
+  #define MQTT_ASYNC_COROUTINES 1
+#endif
+
+#define MQTT_ASYNC_ACK_TIMEOUT_MS 10000   // 等待 PUBACK 的默认超时
+
+// ========================
+// 收到的命令
+// ========================
+struct AsyncCommand {
+  String topic;       // 完整主题
+  String command;     // command 字段（可能为空）
+  String payload;     // 原始 JSON
+  bool timedOut;      // 等待超时
+};
+
+typedef std::function<void()> AsyncCallback;
+typedef std::function<void(bool ok)> AsyncResultCallback;
+typedef std::function<void(const AsyncCommand& command)> AsyncCommandCallback;
+
+#ifdef MQTT_ASYNC_COROUTINES
+// ========================
+// 协程任务（由执行器调度，结束时自动销毁）
+// ========================
+class AsyncTask {
+public:
+  struct promise_type {
+    AsyncTask get_return_object() {
+      return AsyncTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { abort(); }
+  };
+
+  AsyncTask(AsyncTask&& other) noexcept : handle(other.handle) {
+    other.handle = nullptr;
+  }
+
+  ~AsyncTask() {
+    // 未交给执行器的任务直接销毁
+    if (handle) handle.destroy();
+  }
+
+  std::coroutine_handle<> release() {
+    std::coroutine_handle<> h = handle;
+    handle = nullptr;
+    return h;
+  }
+
+private:
+  explicit AsyncTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+  std::coroutine_handle<promise_type> handle;
+};
+#endif
+
+// ========================
+// 单线程执行器 + 异步 MQTT 接口
+// 发布确认回调由本类占用（MQTTManager::setPublishAckHandler）
+// ========================
+class MQTTAsync {
+private:
+  struct Timer {
+    uint32_t due;
+    AsyncCallback done;
+  };
+
+  struct CommandWaiter {
+    String topic;
+    uint32_t due;             // 0 表示不超时
+    AsyncCommandCallback done;
+  };
+
+  struct AckWaiter {
+    int msgId;
+    uint32_t due;
+    AsyncResultCallback done;
+  };
+
+  MQTTManager& manager;
+  std::deque<AsyncCallback> ready;
+  std::vector<Timer> timers;
+  std::vector<CommandWaiter> waiters;
+  std::vector<AckWaiter> ackWaiters;
+  std::vector<AsyncCallback> pendingOps;
+
+public:
+  explicit MQTTAsync(MQTTManager& mqttManager) : manager(mqttManager) {
+    manager.addMessageObserver([this](const char* topic, JsonDocument& doc) {
+      this->onMessage(topic, doc);
+    });
+    manager.setPublishAckHandler([this](int msgId) {
+      this->onPublishAck(msgId);
+    });
+  }
+
+  // ========================
+  // 驱动执行器（在 Arduino loop 中调用）
+  // ========================
+  void loop() {
+    manager.loop();
+
+    // 执行挂起的 MQTT 操作
+    std::vector<AsyncCallback> ops;
+    ops.swap(pendingOps);
+    for (auto& op : ops) {
+      op();
+    }
+
+    uint32_t now = millis();
+
+    // 到期的定时器
+    for (size_t i = 0; i < timers.size();) {
+      if ((int32_t)(now - timers[i].due) >= 0) {
+        ready.push_back(timers[i].done);
+        timers.erase(timers.begin() + i);
+      } else {
+        i++;
+      }
+    }
+
+    // 超时的命令等待
+    for (size_t i = 0; i < waiters.size();) {
+      if (waiters[i].due != 0 && (int32_t)(now - waiters[i].due) >= 0) {
+        AsyncCommandCallback done = waiters[i].done;
+        ready.push_back([done]() {
+          AsyncCommand timeout{"", "", "", true};
+          done(timeout);
+        });
+        waiters.erase(waiters.begin() + i);
+      } else {
+        i++;
+      }
+    }
+
+    // 超时未确认的发布
+    for (size_t i = 0; i < ackWaiters.size();) {
+      if ((int32_t)(now - ackWaiters[i].due) >= 0) {
+        AsyncResultCallback done = ackWaiters[i].done;
+        ready.push_back([done]() { done(false); });
+        ackWaiters.erase(ackWaiters.begin() + i);
+      } else {
+        i++;
+      }
+    }
+
+    // 只执行本轮之前就绪的回调，新就绪的留到下一轮
+    size_t count = ready.size();
+    for (size_t i = 0; i < count; i++) {
+      AsyncCallback fn = ready.front();
+      ready.pop_front();
+      fn();
+    }
+  }
+
+  // ========================
+  // 延时 ms 毫秒后回调
+  // ========================
+  void sleepAsync(uint32_t ms, AsyncCallback done) {
+    if (ms == 0) {
+      ready.push_back(done);
+      return;
+    }
+    timers.push_back({(uint32_t)(millis() + ms), done});
+  }
+
+  // ========================
+  // 连接（已连接时直接回调 true）
+  // ========================
+  void connectAsync(AsyncResultCallback done) {
+    if (manager.isConnected()) {
+      ready.push_back([done]() { done(true); });
+      return;
+    }
+    pendingOps.push_back([this, done]() {
+      bool ok = manager.connect();
+      ready.push_back([done, ok]() { done(ok); });
+    });
+  }
+
+  // ========================
+  // 发布并等待服务器确认：qos > 0 时在收到 PUBACK 后回调 true，
+  // 超时或发送失败回调 false；后端只支持 QoS 0 时（PubSubClient）报文写入连接即回调 true
+  // ========================
+  void publishAsync(const char* topic, const char* message, AsyncResultCallback done,
+                    uint8_t qos = 1, uint32_t ackTimeoutMs = MQTT_ASYNC_ACK_TIMEOUT_MS) {
+    String t(topic);
+    String m(message);
+    pendingOps.push_back([this, t, m, done, qos, ackTimeoutMs]() {
+      int msgId = manager.publishTracked(t.c_str(), m.c_str(), qos);
+      if (msgId > 0) {
+        ackWaiters.push_back({msgId, (uint32_t)(millis() + ackTimeoutMs), done});
+      } else {
+        bool ok = msgId == 0;
+        ready.push_back([done, ok]() { done(ok); });
+      }
+    });
+  }
+
+  // ========================
+  // 等待某主题的下一条命令（timeoutMs 为 0 表示不超时）
+  // 首次等待某主题时自动注册并订阅
+  // ========================
+  void nextCommandAsync(const char* subTopic, uint32_t timeoutMs, AsyncCommandCallback done) {
+    if (!manager.hasTopic(subTopic)) {
+      manager.registerTopic(subTopic);
+    }
+    uint32_t due = timeoutMs ? (uint32_t)(millis() + timeoutMs) : 0;
+    if (due == 0 && timeoutMs) due = 1;
+    waiters.push_back({manager.getFullTopic(subTopic), due, done});
+  }
+
+  size_t getPendingAckCount() {
+    return ackWaiters.size();
+  }
+
+#ifdef MQTT_ASYNC_COROUTINES
+  // ========================
+  // 启动协程任务
+  // ========================
+  void spawn(AsyncTask task) {
+    std::coroutine_handle<> h = task.release();
+    ready.push_back([h]() { h.resume(); });
+  }
+
+  // co_await sleep(ms)
+  struct SleepAwaiter {
+    MQTTAsync* executor;
+    uint32_t ms;
+    bool await_ready() { return ms == 0; }
+    void await_suspend(std::coroutine_handle<> h) {
+      executor->sleepAsync(ms, [h]() { h.resume(); });
+    }
+    void await_resume() {}
+  };
+
+  SleepAwaiter sleep(uint32_t ms) {
+    return SleepAwaiter{this, ms};
+  }
+
+  // co_await connect()，返回是否已连接
+  struct ConnectAwaiter {
+    MQTTAsync* executor;
+    bool result;
+    bool await_ready() {
+      result = executor->manager.isConnected();
+      return result;
+    }
+    void await_suspend(std::coroutine_handle<> h) {
+      executor->connectAsync([this, h](bool ok) {
+        result = ok;
+        h.resume();
+      });
+    }
+    bool await_resume() { return result; }
+  };
+
+  ConnectAwaiter connect() {
+    return ConnectAwaiter{this, false};
+  }
+
+  // co_await publish(topic, message)，收到 PUBACK 后恢复（语义同 publishAsync）
+  struct PublishAwaiter {
+    MQTTAsync* executor;
+    String topic;
+    String message;
+    uint8_t qos;
+    bool result;
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+      executor->publishAsync(topic.c_str(), message.c_str(), [this, h](bool ok) {
+        result = ok;
+        h.resume();
+      }, qos);
+    }
+    bool await_resume() { return result; }
+  };
+
+  PublishAwaiter publish(const char* topic, const char* message, uint8_t qos = 1) {
+    return PublishAwaiter{this, String(topic), String(message), qos, false};
+  }
+
+  // co_await nextCommand(topic, timeoutMs)
+  struct CommandAwaiter {
+    MQTTAsync* executor;
+    String subTopic;
+    uint32_t timeoutMs;
+    AsyncCommand command;
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+      executor->nextCommandAsync(subTopic.c_str(), timeoutMs, [this, h](const AsyncCommand& cmd) {
+        command = cmd;
+        h.resume();
+      });
+    }
+    AsyncCommand await_resume() { return command; }
+  };
+
+  CommandAwaiter nextCommand(const char* subTopic, uint32_t timeoutMs = 0) {
+    return CommandAwaiter{this, String(subTopic), timeoutMs, AsyncCommand{"", "", "", false}};
+  }
+#endif
+
+private:
+  // ========================
+  // 把收到的消息交给等待该主题的回调
+  // ========================
+  void onMessage(const char* topic, JsonDocument& doc) {
+    for (size_t i = 0; i < waiters.size();) {
+      if (waiters[i].topic == topic) {
+        AsyncCommand cmd;
+        cmd.topic = String(topic);
+        cmd.command = doc["command"] | "";
+        serializeJson(doc, cmd.payload);
+        cmd.timedOut = false;
+        AsyncCommandCallback done = waiters[i].done;
+        ready.push_back([done, cmd]() { done(cmd); });
+        waiters.erase(waiters.begin() + i);
+      } else {
+        i++;
+      }
+    }
+  }
+
+  // ========================
+  // 服务器确认（在 manager.loop() 中由后端回调）
+  // ========================
+  void onPublishAck(int msgId) {
+    for (size_t i = 0; i < ackWaiters.size(); i++) {
+      if (ackWaiters[i].msgId == msgId) {
+        AsyncResultCallback done = ackWaiters[i].done;
+        ready.push_back([done]() { done(true); });
+        ackWaiters.erase(ackWaiters.begin() + i);
+        return;
+      }
+    }
+  }
+};
+
+#endif
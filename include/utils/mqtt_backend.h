@@ -0,0 +1,492 @@
+// include/mqtt_backend.h
+#ifndef MQTT_BACKEND_H
+#define MQTT_BACKEND_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <PubSubClient.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include "mqtt_packet.h"
+#include "mpsc_queue.h"
+
+// ========================
+// MQTT 客户端后端接口
+// MQTTManager 只通过该接口收发，不再依赖具体的客户端库
+// ========================
+typedef std::function<void(char* topic, uint8_t* payload, unsigned int length)> BackendMessageHandler;
+typedef std::function<void(int msgId)> PublishAckHandler;
+
+struct MqttConnectOptions {
+  const char* host;               // 为空时沿用后端已有的服务器设置
+  uint16_t port;
+  const char* clientId;
+  const char* username;           // 为空表示匿名
+  const char* password;
+  bool cleanSession;
+  uint16_t keepAliveSec;
+};
+
+// CONNACK 中的 session present 标志
+#define MQTT_SESSION_UNKNOWN -1         // 后端不暴露该标志（如 PubSubClient）
+#define MQTT_SESSION_NEW 0              // 服务器没有保留会话，订阅需要重建
+#define MQTT_SESSION_PRESENT 1          // 服务器保留了会话和订阅
+
+class MqttBackend {
+public:
+  virtual ~MqttBackend() {}
+  virtual const char* name() = 0;
+  virtual bool connect(const MqttConnectOptions& options) = 0;
+  virtual void disconnect() = 0;
+  virtual bool connected() = 0;
+  virtual void loop() = 0;
+  virtual bool publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos, bool retain) = 0;
+  virtual bool subscribe(const std::vector<String>& filters, uint8_t qos) = 0;
+  virtual bool unsubscribe(const std::vector<String>& filters) = 0;
+  virtual void setMessageHandler(BackendMessageHandler handler) = 0;
+  virtual int state() = 0;
+  virtual uint8_t maxPublishQos() = 0;
+
+  // 发布并返回报文 ID：>0 时在服务器确认（QoS 1 PUBACK / QoS 2 PUBCOMP）后
+  // 经确认回调通知（在 loop() 中调用）；0 表示已发出但不会有确认（QoS 0 或后端不支持）；<0 表示失败
+  virtual int publishTracked(const char* topic, const uint8_t* payload, size_t length, uint8_t qos, bool retain) {
+    return publish(topic, payload, length, qos, retain) ? 0 : -1;
+  }
+
+  virtual void setPublishAckHandler(PublishAckHandler handler) {}
+
+  // 最近一次连接的 session present 标志（MQTT_SESSION_*）
+  virtual int8_t sessionPresent() { return MQTT_SESSION_UNKNOWN; }
+
+  // 自带重连的后端（如 esp-mqtt）在后台连上或重连后返回一次 true，
+  // 由调用方补做连接后的处理（重建订阅、上线消息）
+  virtual bool takeReconnected() { return false; }
+
+  // 连接正在后台进行（connect() 不阻塞的后端），此时不应再调用 connect()
+  virtual bool connectPending() { return false; }
+
+  // 更换底层 TCP 连接（只有基于 Client 的后端支持）
+  virtual bool setTransport(Client* client) { return false; }
+};
+
+// ========================
+// PubSubClient 后端（同步、单报文、发布仅 QoS 0，需要轮询 loop）
+// ========================
+class PubSubClientBackend : public MqttBackend {
+private:
+  PubSubClient* client;
+  Client* transport;              // 已知底层连接时批量订阅
+  String host;                    // PubSubClient 只保存指针，这里持有副本
+
+public:
+  explicit PubSubClientBackend(PubSubClient* pubSubClient) : client(pubSubClient), transport(nullptr) {}
+
+  const char* name() override { return "pubsubclient"; }
+
+  bool connect(const MqttConnectOptions& o) override {
+    if (o.host && o.host[0] != '\0' && o.port != 0) {
+      host = String(o.host);
+      client->setServer(host.c_str(), o.port);
+    }
+    if (o.keepAliveSec) client->setKeepAlive(o.keepAliveSec);
+    return client->connect(o.clientId, o.username, o.password, nullptr, 0, false, nullptr, o.cleanSession);
+  }
+
+  void disconnect() override { client->disconnect(); }
+  bool connected() override { return client->connected(); }
+  void loop() override { client->loop(); }
+  int state() override { return client->state(); }
+  uint8_t maxPublishQos() override { return 0; }
+
+  bool publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos, bool retain) override {
+    // 超出客户端缓冲的消息（如图像）以流式写入，不需要加大缓冲
+    if (length + strlen(topic) + 7 > client->getBufferSize()) {
+      if (!client->beginPublish(topic, length, retain)) return false;
+      if (client->write(payload, length) != length) return false;
+      return client->endPublish() == 1;
+    }
+    return client->publish(topic, payload, length, retain);
+  }
+
+  bool subscribe(const std::vector<String>& filters, uint8_t qos) override {
+    if (transport) {
+      return mqttSendBatch(transport, MQTT_PACKET_SUBSCRIBE, filters, qos);
+    }
+    bool allOk = true;
+    for (auto& t : filters) allOk &= client->subscribe(t.c_str(), qos);
+    return allOk;
+  }
+
+  bool unsubscribe(const std::vector<String>& filters) override {
+    if (transport) {
+      return mqttSendBatch(transport, MQTT_PACKET_UNSUBSCRIBE, filters);
+    }
+    bool allOk = true;
+    for (auto& t : filters) allOk &= client->unsubscribe(t.c_str());
+    return allOk;
+  }
+
+  void setMessageHandler(BackendMessageHandler handler) override {
+    client->setCallback(handler);
+  }
+
+  bool setTransport(Client* c) override {
+    transport = c;
+    if (c) client->setClient(*c);
+    return true;
+  }
+};
+
+// ========================
+// 回环后端（主机测试 / 基准）
+// 进程内的迷你 broker：发布的消息投递给自身匹配的订阅，在 loop() 中分发
+// 不依赖网络，设备端也能编译；仓库中没有运行它的测试
+// ========================
+class LoopbackMqttBackend : public MqttBackend {
+private:
+  struct Pending {
+    String topic;
+    std::vector<uint8_t> payload;
+  };
+
+  std::vector<String> filters;
+  std::vector<Pending> pending;
+  std::vector<int> pendingAcks;
+  BackendMessageHandler handler;
+  PublishAckHandler ackHandler;
+  bool isConnected;
+  bool sessionKept;
+  uint32_t publishedCount;
+  int nextMsgId;
+
+public:
+  LoopbackMqttBackend() : isConnected(false), sessionKept(false), publishedCount(0), nextMsgId(0) {}
+
+  const char* name() override { return "loopback"; }
+  bool connect(const MqttConnectOptions& o) override {
+    if (o.cleanSession) filters.clear();
+    sessionKept = !o.cleanSession && !filters.empty();
+    isConnected = true;
+    return true;
+  }
+  int8_t sessionPresent() override { return sessionKept ? MQTT_SESSION_PRESENT : MQTT_SESSION_NEW; }
+
+  // 模拟服务器丢失会话（如 broker 重启）
+  void dropSession() {
+    filters.clear();
+  }
+
+  void disconnect() override { isConnected = false; }
+  bool connected() override { return isConnected; }
+  int state() override { return isConnected ? 0 : -1; }
+  uint8_t maxPublishQos() override { return 2; }
+
+  void loop() override {
+    std::vector<Pending> batch;
+    batch.swap(pending);
+    for (auto& p : batch) {
+      if (!handler) break;
+      p.payload.push_back(0);
+      handler(const_cast<char*>(p.topic.c_str()), p.payload.data(), p.payload.size() - 1);
+    }
+
+    // QoS > 0 的发布在下一轮确认
+    std::vector<int> acks;
+    acks.swap(pendingAcks);
+    for (int id : acks) {
+      if (ackHandler) ackHandler(id);
+    }
+  }
+
+  int publishTracked(const char* topic, const uint8_t* payload, size_t length, uint8_t qos, bool retain) override {
+    if (!publish(topic, payload, length, qos, retain)) return -1;
+    if (qos == 0) return 0;
+    nextMsgId = nextMsgId % 0xFFFF + 1;
+    pendingAcks.push_back(nextMsgId);
+    return nextMsgId;
+  }
+
+  void setPublishAckHandler(PublishAckHandler h) override { ackHandler = h; }
+
+  bool publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos, bool retain) override {
+    if (!isConnected) return false;
+    publishedCount++;
+    for (auto& f : filters) {
+      if (topicMatches(f.c_str(), topic)) {
+        pending.push_back({String(topic), std::vector<uint8_t>(payload, payload + length)});
+        break;
+      }
+    }
+    return true;
+  }
+
+  bool subscribe(const std::vector<String>& list, uint8_t qos) override {
+    for (auto& f : list) {
+      if (std::find(filters.begin(), filters.end(), f) == filters.end()) filters.push_back(f);
+    }
+    return isConnected;
+  }
+
+  bool unsubscribe(const std::vector<String>& list) override {
+    for (auto& f : list) {
+      filters.erase(std::remove(filters.begin(), filters.end(), f), filters.end());
+    }
+    return isConnected;
+  }
+
+  void setMessageHandler(BackendMessageHandler h) override { handler = h; }
+
+  // ========================
+  // 从外部注入一条下行消息（模拟服务器推送）
+  // ========================
+  void inject(const char* topic, const char* payload) {
+    pending.push_back({String(topic), std::vector<uint8_t>(payload, payload + strlen(payload))});
+  }
+
+  uint32_t getPublishedCount() { return publishedCount; }
+
+  // MQTT 通配符匹配（+ 单层，# 多层）
+  static bool topicMatches(const char* filter, const char* topic) {
+    while (*filter && *topic) {
+      if (*filter == '#') return true;
+      if (*filter == '+') {
+        while (*topic && *topic != '/') topic++;
+        filter++;
+        continue;
+      }
+      if (*filter != *topic) return false;
+      filter++;
+      topic++;
+    }
+    if (*filter == '/' && filter[1] == '#') return true;
+    return *filter == *topic || (*filter == '#');
+  }
+};
+
+// ========================
+// ESP-IDF esp-mqtt 后端
+// 客户端在自己的任务中运行，自带发件箱，支持 QoS 1/2；
+// 下行消息经无锁队列交给调用 loop() 的任务，回调线程模型与 PubSubClient 一致
+// ========================
+#if defined(ESP32) && __has_include(<mqtt_client.h>)
+
+#include <mqtt_client.h>
+#include <esp_idf_version.h>
+#include <atomic>
+
+#define ESP_MQTT_INBOX_SIZE 8           // 必须是 2 的幂
+#define ESP_MQTT_TOPIC_LEN 96
+#define ESP_MQTT_PAYLOAD_LEN 512
+#define ESP_MQTT_ACK_QUEUE 16           // 待分发的发布确认（必须是 2 的幂）
+
+struct EspMqttInbound {
+  char topic[ESP_MQTT_TOPIC_LEN];
+  uint8_t payload[ESP_MQTT_PAYLOAD_LEN + 1];
+  uint16_t length;
+};
+
+class EspMqttBackend : public MqttBackend {
+private:
+  esp_mqtt_client_handle_t handle;
+  std::atomic<bool> isConnected;
+  std::atomic<bool> reconnected;        // CONNECTED 事件锁存，由 takeReconnected() 取走
+  std::atomic<int8_t> sessionFlag;
+  std::atomic<int> lastError;
+  std::atomic<uint32_t> droppedOversize;    // 主题或负载超过槽位
+  std::atomic<uint32_t> droppedFragmented;  // 分片消息
+  uint32_t reportedDrops;
+  MpscQueue<EspMqttInbound, ESP_MQTT_INBOX_SIZE> inbox;
+  MpscQueue<int, ESP_MQTT_ACK_QUEUE> acks;  // MQTT_EVENT_PUBLISHED 的报文 ID
+  BackendMessageHandler handler;
+  PublishAckHandler ackHandler;
+  String uri;
+
+public:
+  EspMqttBackend() : handle(nullptr), isConnected(false), reconnected(false), sessionFlag(MQTT_SESSION_UNKNOWN),
+                     lastError(0), droppedOversize(0), droppedFragmented(0), reportedDrops(0) {}
+
+  ~EspMqttBackend() {
+    if (handle) {
+      esp_mqtt_client_stop(handle);
+      esp_mqtt_client_destroy(handle);
+    }
+  }
+
+  const char* name() override { return "esp-mqtt"; }
+  uint8_t maxPublishQos() override { return 2; }
+
+  bool connect(const MqttConnectOptions& o) override {
+    if (handle == nullptr) {
+      uri = String("mqtt://") + o.host + ":" + String(o.port);
+
+      esp_mqtt_client_config_t cfg = {};
+      #if ESP_IDF_VERSION_MAJOR >= 5
+        cfg.broker.address.uri = uri.c_str();
+        cfg.credentials.client_id = o.clientId;
+        cfg.credentials.username = o.username;
+        cfg.credentials.authentication.password = o.password;
+        cfg.session.disable_clean_session = !o.cleanSession;
+        cfg.session.keepalive = o.keepAliveSec ? o.keepAliveSec : 15;
+      #else
+        cfg.uri = uri.c_str();
+        cfg.client_id = o.clientId;
+        cfg.username = o.username;
+        cfg.password = o.password;
+        cfg.disable_clean_session = !o.cleanSession;
+        cfg.keepalive = o.keepAliveSec ? o.keepAliveSec : 15;
+      #endif
+
+      handle = esp_mqtt_client_init(&cfg);
+      if (handle == nullptr) {
+        lastError = -2;
+        return false;
+      }
+      esp_mqtt_client_register_event(handle, MQTT_EVENT_ANY, &EspMqttBackend::onEvent, this);
+      if (esp_mqtt_client_start(handle) != ESP_OK) {
+        // 启动失败时释放句柄，否则 connectPending() 一直为真，调用方不再重试
+        esp_mqtt_client_destroy(handle);
+        handle = nullptr;
+        lastError = -2;
+        return false;
+      }
+    }
+
+    // 不等待：esp-mqtt 在自己的任务中连接和重连，结果经 CONNECTED 事件锁存，
+    // 调用方通过 takeReconnected() 得知
+    return isConnected;
+  }
+
+  bool connectPending() override { return handle != nullptr && !isConnected; }
+  int8_t sessionPresent() override { return sessionFlag; }
+  bool takeReconnected() override { return reconnected.exchange(false); }
+
+  // 停止并销毁客户端：只断开连接的话 esp-mqtt 任务会自行重连；下次 connect() 重新创建
+  void disconnect() override {
+    if (handle) {
+      esp_mqtt_client_stop(handle);
+      esp_mqtt_client_destroy(handle);
+      handle = nullptr;
+    }
+    isConnected = false;
+    reconnected = false;
+    sessionFlag = MQTT_SESSION_UNKNOWN;
+  }
+
+  bool connected() override { return isConnected; }
+  int state() override { return isConnected ? 0 : lastError.load(); }
+
+  void loop() override {
+    EspMqttInbound msg;
+    while (inbox.tryPop(msg)) {
+      if (handler) handler(msg.topic, msg.payload, msg.length);
+    }
+
+    int msgId;
+    while (acks.tryPop(msgId)) {
+      if (ackHandler) ackHandler(msgId);
+    }
+
+    // 丢弃在 esp-mqtt 任务中计数，这里输出日志
+    uint32_t drops = getDroppedCount();
+    if (drops != reportedDrops) {
+      Serial.printf("⚠ esp-mqtt inbound dropped: %u oversize, %u fragmented, %u inbox full\n",
+                    (unsigned)droppedOversize.load(), (unsigned)droppedFragmented.load(),
+                    (unsigned)inbox.droppedCount());
+      reportedDrops = drops;
+    }
+  }
+
+  bool publish(const char* topic, const uint8_t* payload, size_t length, uint8_t qos, bool retain) override {
+    if (!handle || !isConnected) return false;
+    // 写入发件箱后立即返回，由 esp-mqtt 任务发送 / 重传
+    return esp_mqtt_client_enqueue(handle, topic, (const char*)payload, length, qos, retain, true) >= 0;
+  }
+
+  int publishTracked(const char* topic, const uint8_t* payload, size_t length, uint8_t qos, bool retain) override {
+    if (!handle || !isConnected) return -1;
+    int msgId = esp_mqtt_client_enqueue(handle, topic, (const char*)payload, length, qos, retain, true);
+    if (msgId < 0) return -1;
+    return qos > 0 ? msgId : 0;
+  }
+
+  void setPublishAckHandler(PublishAckHandler h) override { ackHandler = h; }
+
+  bool subscribe(const std::vector<String>& filters, uint8_t qos) override {
+    if (!handle || filters.empty()) return filters.empty();
+    #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+      std::vector<esp_mqtt_topic_t> list;
+      list.reserve(filters.size());
+      for (auto& f : filters) list.push_back({f.c_str(), qos});
+      return esp_mqtt_client_subscribe_multiple(handle, list.data(), list.size()) >= 0;
+    #else
+      bool allOk = true;
+      for (auto& f : filters) allOk &= esp_mqtt_client_subscribe(handle, f.c_str(), qos) >= 0;
+      return allOk;
+    #endif
+  }
+
+  bool unsubscribe(const std::vector<String>& filters) override {
+    if (!handle) return false;
+    bool allOk = true;
+    for (auto& f : filters) allOk &= esp_mqtt_client_unsubscribe(handle, f.c_str()) >= 0;
+    return allOk;
+  }
+
+  void setMessageHandler(BackendMessageHandler h) override { handler = h; }
+
+  // 所有原因丢弃的下行消息数
+  uint32_t getDroppedCount() { return inbox.droppedCount() + droppedOversize + droppedFragmented; }
+  uint32_t getOversizeDrops() { return droppedOversize; }
+  uint32_t getFragmentedDrops() { return droppedFragmented; }
+
+private:
+  // 在 esp-mqtt 任务中运行
+  static void onEvent(void* arg, esp_event_base_t base, int32_t eventId, void* eventData) {
+    EspMqttBackend* self = static_cast<EspMqttBackend*>(arg);
+    esp_mqtt_event_handle_t event = static_cast<esp_mqtt_event_handle_t>(eventData);
+
+    switch ((esp_mqtt_event_id_t)eventId) {
+      case MQTT_EVENT_CONNECTED:
+        // esp-mqtt 自动重连时也会走到这里；锁存 session present 供调用方决定是否重建订阅
+        self->sessionFlag = event->session_present ? MQTT_SESSION_PRESENT : MQTT_SESSION_NEW;
+        self->lastError = 0;
+        self->isConnected = true;
+        self->reconnected = true;
+        break;
+      case MQTT_EVENT_DISCONNECTED:
+        self->isConnected = false;
+        break;
+      case MQTT_EVENT_ERROR:
+        self->lastError = -2;
+        break;
+      case MQTT_EVENT_PUBLISHED:
+        // QoS 1 收到 PUBACK / QoS 2 收到 PUBCOMP
+        self->acks.tryPush(event->msg_id);
+        break;
+      case MQTT_EVENT_DATA:
+        // 只接收不分片且不超过槽位的消息，其余计数后丢弃
+        if (event->current_data_offset != 0 || event->data_len != event->total_data_len) {
+          // 每条分片消息只在第一片计数一次
+          if (event->current_data_offset == 0) self->droppedFragmented++;
+        } else if (event->topic_len >= ESP_MQTT_TOPIC_LEN || event->data_len > ESP_MQTT_PAYLOAD_LEN) {
+          self->droppedOversize++;
+        } else {
+          self->inbox.tryPushWith([event](EspMqttInbound& slot) {
+            memcpy(slot.topic, event->topic, event->topic_len);
+            slot.topic[event->topic_len] = '\0';
+            memcpy(slot.payload, event->data, event->data_len);
+            slot.payload[event->data_len] = 0;
+            slot.length = event->data_len;
+          });
+        }
+        break;
+      default:
+        break;
+    }
+  }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,96 @@
+// include/mqtt_event_sink.h
+#ifndef MQTT_EVENT_SINK_H
+#define MQTT_EVENT_SINK_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include "event_bus.h"
+#include "mqtt_manager.h"
+
+// ========================
+// 事件序列化函数：只在事件真正发往 MQTT 时调用
+// ========================
+typedef void (*EventSerializer)(const void* payload, JsonDocument& doc);
+
+struct EventRoute {
+  uint16_t type;
+  String subTopic;
+  EventSerializer serializer;
+};
+
+#define MQTT_SINK_MAX_PENDING (EVENT_POOL_BLOCKS / 2)   // 最多占用一半事件池
+
+// ========================
+// MQTT 事件出口（事件总线的一个订阅者）
+// 事件到达时只保留引用；在 loop() 中且已连接时才序列化并发布
+// ========================
+class MQTTEventSink {
+private:
+  MQTTManager& manager;
+  std::vector<EventRoute> routes;
+  std::vector<EventRef> pending;
+  uint32_t droppedEvents;
+
+public:
+  MQTTEventSink(EventBus& bus, MQTTManager& mqttManager) : manager(mqttManager) {
+    droppedEvents = 0;
+    bus.subscribe(0, &MQTTEventSink::onEvent, this);
+  }
+
+  // ========================
+  // 为事件类型配置主题和序列化函数
+  // ========================
+  void route(uint16_t type, const char* subTopic, EventSerializer serializer) {
+    routes.push_back({type, String(subTopic), serializer});
+  }
+
+  // ========================
+  // 序列化并发布待发送事件（在 loop 中调用）
+  // ========================
+  void loop() {
+    if (pending.empty() || !manager.isConnected()) {
+      return;
+    }
+
+    std::vector<EventRef> batch;
+    batch.swap(pending);
+
+    for (auto& event : batch) {
+      EventRoute* r = findRoute(event.type());
+      if (r == nullptr) continue;
+
+      StaticJsonDocument<256> doc;
+      r->serializer(event.data(), doc);
+      manager.publishJson(r->subTopic.c_str(), doc);
+    }
+  }
+
+  uint32_t getDroppedCount() {
+    return droppedEvents;
+  }
+
+private:
+  static void onEvent(const EventRef& event, void* context) {
+    MQTTEventSink* self = static_cast<MQTTEventSink*>(context);
+    if (self->findRoute(event.type()) == nullptr) {
+      return;
+    }
+
+    // 断线时丢弃最旧的事件，避免占满事件池
+    if (self->pending.size() >= MQTT_SINK_MAX_PENDING) {
+      self->pending.erase(self->pending.begin());
+      self->droppedEvents++;
+    }
+    self->pending.push_back(event);
+  }
+
+  EventRoute* findRoute(uint16_t type) {
+    for (auto& r : routes) {
+      if (r.type == type) return &r;
+    }
+    return nullptr;
+  }
+};
+
+#endif
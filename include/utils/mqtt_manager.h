@@ -5,23 +5,67 @@
 #include <Arduino.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
+#include <algorithm>
+#include <functional>
 #include "wifi_config.h"
+#include "flight_recorder.h"
+#include "trace_scope.h"
+#include "device_shadow.h"
+#include "mqtt_packet.h"
+#include "mpsc_queue.h"
+#include "message_arena.h"
+#include "string_intern.h"
+#include "energy_accounting.h"
+#include "tx_scheduler.h"
+#include "psram_policy.h"
+#include "net_interface.h"
+#include "mqtt_backend.h"
+#include "status_profile.h"
+#include "boot_profiler.h"
 
 // ========================
 // MQTT 回调函数类型定义
 // ========================
 typedef void (*CommandCallback)(const char* command, JsonDocument& payload);
 typedef void (*MessageCallback)(const char* topic, const char* message);
+typedef std::function<void(const char* topic, JsonDocument& doc)> MessageObserver;
 
 // ========================
 // MQTT 主题结构体
 // ========================
 struct MQTTTopic {
-  String name;                    // 主题名称
+  InternedString name;            // 主题名称（驻留字符串）
   CommandCallback onCommand;      // 命令回调
   MessageCallback onMessage;      // 消息回调
 };
 
+// ========================
+// 发布结果（PUBLISH_FAILED 为 0，可以直接按 bool 判断是否被接受）
+// ========================
+enum PublishResult : uint8_t {
+  PUBLISH_FAILED = 0,
+  PUBLISH_SENT,                   // 已交给 MQTT 客户端发送
+  PUBLISH_QUEUED                  // 已缓存到发送窗口，窗口打开时才发送
+};
+
+// ========================
+// 跨任务发布队列
+// ========================
+#define MQTT_PUBLISH_QUEUE_SIZE 8     // 必须是 2 的幂
+#define MQTT_QUEUED_TOPIC_LEN 48
+#define MQTT_QUEUED_PAYLOAD_LEN 192
+
+struct QueuedPublish {
+  char topic[MQTT_QUEUED_TOPIC_LEN];
+  char payload[MQTT_QUEUED_PAYLOAD_LEN];
+};
+
+// ========================
+// 接收路径内存
+// ========================
+#define MQTT_RECEIVE_ARENA_SIZE 1024  // 单条消息的临时内存（原始消息 + JSON 文档）
+#define MQTT_RECEIVE_JSON_CAPACITY 512
+
 // ========================
 // MQTT 设备状态结构体
 // ========================
@@ -40,29 +84,97 @@ struct DeviceStatus {
 // ========================
 class MQTTManager {
 private:
-  PubSubClient* mqttClient;
+  MqttBackend* backend;           // MQTT 客户端后端
+  PubSubClientBackend* ownedBackend;  // 由 PubSubClient 构造时内部创建
+  uint8_t publishQos;             // 发布 QoS（受后端能力限制）
   std::vector<MQTTTopic> topics;
+  std::vector<MessageObserver> observers;  // 收到任意已解析消息时通知
   DeviceStatus deviceStatus;
   
   String baseTopicPrefix;         // 主题前缀，如 "home"
   String deviceId;
-  uint32_t lastStatusPublish;     // 上次状态发布时间
-  uint32_t statusPublishInterval; // 状态发布间隔（毫秒）
+  StatusProfile statusProfiles[STATUS_PROFILE_COUNT];  // 心跳 / 完整状态档位
   bool autoStatusReport;          // 自动状态上报
   bool debugEnabled;              // 调试模式
+  bool flightTracePublished;      // 上次启动的飞行记录是否已上传
+  DeviceShadow* shadow;           // 设备影子（可选）
+  uint32_t lastShadowPublish;     // 上次影子上报时间
+  uint32_t shadowMinInterval;     // 影子上报最小间隔（毫秒，用于合并变化）
+  bool persistentSession;         // 持久会话（clean session = false）
+  bool sessionSubscribed;         // 服务器端会话中订阅是否已建立
+  NetInterface* netInterface;     // 网络接口（为空时按 Wi-Fi 处理）
+  std::vector<String> activeSubscriptions;  // 服务器端当前已订阅的完整主题
+  bool subscriptionsDirty;        // 本地主题与服务器订阅不一致
+  // 其他任务 / 中断提交的消息；槽位是对象内的定长数组，不走 BUF_PUBLISH_QUEUE 策略：
+  // publishFromISR 可能在 flash 缓存关闭时运行，此时 PSRAM 不可访问，必须留在内部 SRAM
+  MpscQueue<QueuedPublish, MQTT_PUBLISH_QUEUE_SIZE> publishQueue;
+  uint8_t receiveArenaStorage[MQTT_RECEIVE_ARENA_SIZE];
+  MessageArena receiveArena;      // 接收路径的临时分配，每条消息处理完后重置
+  uint8_t receiveDepth;           // 消息处理嵌套层数（回调中再次调用 loop() 时大于 1）
+  EnergyAccounting energy;        // 射频能耗统计
+  EnergySubsystem txSubsystem;    // 当前发送归属的子系统
+  uint32_t lastEnergyReport;      // 上次能耗报告时间
+  uint32_t energyReportInterval;  // 能耗报告间隔（毫秒，0 表示关闭）
+  TxScheduler txScheduler;        // 发送窗口调度
+  bool flushingWindow;            // 正在发送窗口内的消息
+  uint32_t connectStartedAt;      // 最近一次发起连接的时间
 
 public:
   // ========================
   // 构造函数
   // ========================
-  MQTTManager(PubSubClient* client, const char* deviceId, const char* prefix = "home") {
-    mqttClient = client;
+  MQTTManager(PubSubClient* client, const char* deviceId, const char* prefix = "home")
+    : receiveArena(receiveArenaStorage, sizeof(receiveArenaStorage)) {
+    ownedBackend = client ? new PubSubClientBackend(client) : nullptr;
+    init(ownedBackend, deviceId, prefix);
+  }
+
+  // 使用指定的后端（如 EspMqttBackend / LoopbackMqttBackend）
+  MQTTManager(MqttBackend* mqttBackend, const char* deviceId, const char* prefix = "home")
+    : receiveArena(receiveArenaStorage, sizeof(receiveArenaStorage)) {
+    ownedBackend = nullptr;
+    init(mqttBackend, deviceId, prefix);
+  }
+
+  ~MQTTManager() {
+    delete ownedBackend;
+  }
+
+  // 持有 ownedBackend 且接收内存指向自身成员，禁止拷贝 / 移动
+  MQTTManager(const MQTTManager&) = delete;
+  MQTTManager& operator=(const MQTTManager&) = delete;
+  MQTTManager(MQTTManager&&) = delete;
+  MQTTManager& operator=(MQTTManager&&) = delete;
+
+private:
+  void init(MqttBackend* mqttBackend, const char* deviceId, const char* prefix) {
+    backend = mqttBackend;
+    publishQos = 0;
     this->deviceId = String(deviceId);
     baseTopicPrefix = String(prefix);
-    lastStatusPublish = 0;
-    statusPublishInterval = 30000;  // 默认 30 秒
+    // 心跳：10 秒，只含运行时间和信号强度，紧凑键名；普通优先级，启用发送窗口时随窗口发送
+    statusProfiles[STATUS_HEARTBEAT] = {"heartbeat", 10000, STATUS_FIELD_UPTIME | STATUS_FIELD_RSSI,
+                                        true, PRIORITY_NORMAL, 0};
+    // 完整状态：30 秒（与原 statusPublishInterval 默认值相同），或通过 <prefix>/<id>/status/get 按需请求
+    statusProfiles[STATUS_FULL] = {"status", 30000, STATUS_FIELD_ALL, false, PRIORITY_NORMAL, 0};
     autoStatusReport = true;
     debugEnabled = true;
+    flightTracePublished = false;
+    shadow = nullptr;
+    lastShadowPublish = 0;
+    shadowMinInterval = 200;
+    persistentSession = false;
+    sessionSubscribed = false;
+    netInterface = nullptr;
+    subscriptionsDirty = false;
+    txSubsystem = ENERGY_PUBLISH;
+    lastEnergyReport = 0;
+    energyReportInterval = 600000;  // 默认 10 分钟
+    flushingWindow = false;
+    connectStartedAt = 0;
+    receiveDepth = 0;
+    
+    flightRecorderBegin();
     
     deviceStatus.deviceId = this->deviceId;
     deviceStatus.chipType = CHIP_TYPE;
@@ -70,36 +182,68 @@ public:
     deviceStatus.uptime = 0;
     
     // 设置 MQTT 回调
-    if (mqttClient) {
-      mqttClient->setCallback([this](char* topic, byte* payload, unsigned int length) {
+    if (backend) {
+      backend->setMessageHandler([this](char* topic, uint8_t* payload, unsigned int length) {
         this->onMqttMessage(topic, payload, length);
       });
     }
   }
 
+public:
+
   // ========================
   // 注册主题和回调
   // ========================
   void registerTopic(const char* topicName, CommandCallback cmdCallback = nullptr, MessageCallback msgCallback = nullptr) {
     MQTTTopic newTopic;
-    newTopic.name = String(topicName);
+    newTopic.name = InternedString(topicName);
     newTopic.onCommand = cmdCallback;
     newTopic.onMessage = msgCallback;
     
     topics.push_back(newTopic);
+    subscriptionsDirty = true;
     
     if (debugEnabled) {
       Serial.println("✓ Registered topic: " + String(topicName));
     }
   }
 
+  // ========================
+  // 添加消息观察者（在主题回调之前收到所有已解析的消息）
+  // ========================
+  void addMessageObserver(MessageObserver observer) {
+    observers.push_back(observer);
+  }
+
+  // ========================
+  // 主题是否已注册
+  // ========================
+  bool hasTopic(const char* topicName) {
+    InternedString id;
+    if (!InternedString::lookup(topicName, id)) return false;
+    for (auto& t : topics) {
+      if (t.name == id) return true;
+    }
+    return false;
+  }
+
+  // ========================
+  // 获取完整主题名
+  // ========================
+  String getFullTopic(const char* subTopic) {
+    return buildTopic(subTopic);
+  }
+
   // ========================
   // 注销主题
   // ========================
   void unregisterTopic(const char* topicName) {
+    InternedString id;
+    if (!InternedString::lookup(topicName, id)) return;
     for (auto it = topics.begin(); it != topics.end(); ++it) {
-      if (it->name == topicName) {
+      if (it->name == id) {
         topics.erase(it);
+        subscriptionsDirty = true;
         if (debugEnabled) {
           Serial.println("✗ Unregistered topic: " + String(topicName));
         }
@@ -112,7 +256,8 @@ public:
   // 连接 MQTT 服务器
   // ========================
   bool connect() {
-    if (!mqttClient) {
+    TRACE_SCOPE("mqtt.connect", "mqtt");
+    if (!backend) {
       if (debugEnabled) Serial.println("✗ MQTT Client not initialized");
       return false;
     }
@@ -128,45 +273,100 @@ public:
     }
 
     // 连接 MQTT 服务器
-    bool connected = false;
-    if (username.length() > 0 && password.length() > 0) {
-      connected = mqttClient->connect(deviceId.c_str(), username.c_str(), password.c_str());
-    } else {
-      connected = mqttClient->connect(deviceId.c_str());
-    }
+    flightRecord(FR_EVT_CONNECT_ATTEMPT);
+    connectStartedAt = millis();
+    // 持久会话使用固定的设备 ID 作为 client id，并关闭 clean session
+    uint32_t radioStart = micros();
+    bool hasAuth = username.length() > 0 && password.length() > 0;
+    MqttConnectOptions options;
+    options.host = server.c_str();
+    options.port = (uint16_t)port;
+    options.clientId = deviceId.c_str();
+    options.username = hasAuth ? username.c_str() : nullptr;
+    options.password = hasAuth ? password.c_str() : nullptr;
+    options.cleanSession = !persistentSession;
+    options.keepAliveSec = 0;
+    bool connected = backend->connect(options);
+    uint32_t connectUs = micros() - radioStart;
+    energy.recordRadioOn(ENERGY_RECONNECT, connectUs,
+                         14 + deviceId.length() + username.length() + password.length());
 
     if (connected) {
-      if (debugEnabled) {
-        Serial.println("✓ MQTT Connected");
-      }
-      
-      deviceStatus.isConnected = true;
-      deviceStatus.lastUpdateTime = millis();
-      
-      // 订阅所有注册的主题
-      subscribeToAllTopics();
-      
-      // 发布上线消息
-      publishOnlineStatus();
-      
+      // 只记录成功的那次连接，失败的重试不占用启动阶段槽位
+      bootProfiler.record("mqtt.connect", radioStart, connectUs);
+      backend->takeReconnected();
+      onConnected();
       return true;
+    } else if (backend->connectPending()) {
+      // 后端在后台连接（esp-mqtt），结果在 loop() 中经 takeReconnected() 处理
+      if (debugEnabled) Serial.println("⚠ MQTT connecting in background");
+      return false;
     } else {
+      flightRecord(FR_EVT_CONNECT_FAIL, (uint32_t)backend->state());
       if (debugEnabled) {
         Serial.print("✗ MQTT Connect failed: ");
-        Serial.println(mqttClient->state());
+        Serial.println(backend->state());
       }
       deviceStatus.isConnected = false;
       return false;
     }
   }
 
+private:
+  // ========================
+  // 连接建立后的处理（同步连接成功，或后端自行重连后）
+  // ========================
+  void onConnected() {
+    flightRecord(FR_EVT_CONNECT_OK, millis() - connectStartedAt);
+    if (debugEnabled) {
+      Serial.println("✓ MQTT Connected");
+    }
+    
+    deviceStatus.isConnected = true;
+    deviceStatus.lastUpdateTime = millis();
+    
+    // 同步订阅：只有后端确认 CONNACK session present 时才信任服务器保留的订阅，
+    // 新会话或后端不暴露该标志（PubSubClient）时全部重建
+    if (persistentSession && sessionSubscribed && backend->sessionPresent() == MQTT_SESSION_PRESENT) {
+      if (debugEnabled) Serial.println("✓ Session resumed, subscriptions kept by broker");
+    } else {
+      activeSubscriptions.clear();
+    }
+    int bootPhase = bootProfiler.begin("mqtt.subscribe");
+    sessionSubscribed = syncSubscriptions() && persistentSession;
+    bootProfiler.end(bootPhase);
+    
+    // 发布上线消息
+    publishOnlineStatus();
+    
+    // 首条消息已发出：停止启动计时并上报；发布失败时下次连接重试
+    if (!bootProfiler.isFinished()) {
+      bootProfiler.markFirstMessage();
+      if (publishBootReport()) {
+        bootProfiler.finish();
+        #ifndef ARDUINO
+          bootProfiler.printReport();
+        #endif
+      }
+    }
+    
+    // 上传上次启动遗留的飞行记录
+    if (!flightTracePublished) {
+      flightTracePublished = publishFlightTrace();
+    }
+  }
+
+public:
   // ========================
   // 断开连接
   // ========================
   void disconnect() {
-    if (mqttClient && mqttClient->connected()) {
+    if (backend && backend->connected()) {
+      if (txScheduler.pending() > 0) {
+        flushTxWindow();
+      }
       publishOfflineStatus();
-      mqttClient->disconnect();
+      backend->disconnect();
       deviceStatus.isConnected = false;
       
       if (debugEnabled) {
@@ -179,33 +379,142 @@ public:
   // 检查连接状态
   // ========================
   bool isConnected() {
-    return mqttClient && mqttClient->connected();
+    return backend && backend->connected();
   }
 
   // ========================
   // 保持连接（在 loop 中调用）
   // ========================
   void loop() {
-    if (!mqttClient) return;
+    if (!backend) return;
 
-    if (!mqttClient->connected()) {
+    if (!backend->connected()) {
+      // 链路未就绪时不尝试连接，避免阻塞在 TCP 超时上
+      if (netInterface && !netInterface->isUp()) return;
+      // 自带重连的后端正在连接，不重复发起
+      if (backend->connectPending()) return;
       connect();
     } else {
-      mqttClient->loop();
+      // 后端自行连上 / 重连（esp-mqtt）：补做连接后的处理，按 session present 重建订阅
+      if (backend->takeReconnected()) {
+        onConnected();
+      }
+      backend->loop();
+      flightRecordHeapLowWater();
+      
+      // 运行期间注册/注销的主题
+      if (subscriptionsDirty) {
+        syncSubscriptions();
+      }
+      
+      // 发送其他任务提交的消息
+      drainPublishQueue();
       
-      // 自动发布状态
-      if (autoStatusReport && (millis() - lastStatusPublish >= statusPublishInterval)) {
-        publishStatus();
-        lastStatusPublish = millis();
+      // 发送窗口
+      if (txScheduler.windowDue()) {
+        flushTxWindow();
       }
+      
+      // 上报影子变化
+      if (shadow && shadow->hasChanges() && (millis() - lastShadowPublish >= shadowMinInterval)) {
+        publishShadow();
+      }
+      
+      // 能耗报告
+      if (energyReportInterval > 0 && (millis() - lastEnergyReport >= energyReportInterval)) {
+        publishEnergyReport();
+        lastEnergyReport = millis();
+      }
+      
+      // 自动发布心跳 / 完整状态
+      if (autoStatusReport) {
+        for (uint8_t i = 0; i < STATUS_PROFILE_COUNT; i++) {
+          StatusProfile& profile = statusProfiles[i];
+          if (profile.intervalMs > 0 && (millis() - profile.lastPublish >= profile.intervalMs)) {
+            publishStatusProfile((StatusProfileId)i);
+          }
+        }
+      }
+    }
+  }
+
+  // ========================
+  // 启用/禁用持久会话
+  // 启用后服务器在断线期间保留订阅和 QoS 1 消息；
+  // 后端报告 session present 时重连不再重发 SUBSCRIBE。
+  // PubSubClient 不暴露该标志，每次重连仍会重建订阅
+  // ========================
+  void setPersistentSession(bool enabled) {
+    persistentSession = enabled;
+    sessionSubscribed = false;
+  }
+
+  // ========================
+  // 设置发布 QoS（PubSubClient 只支持 0，esp-mqtt 支持 1/2）
+  // ========================
+  void setPublishQos(uint8_t qos) {
+    uint8_t maxQos = backend ? backend->maxPublishQos() : 0;
+    publishQos = qos > maxQos ? maxQos : qos;
+    if (debugEnabled && publishQos != qos) {
+      Serial.printf("⚠ Backend supports QoS %u at most\n", (unsigned)maxQos);
+    }
+  }
+
+  MqttBackend* getBackend() {
+    return backend;
+  }
+
+  // ========================
+  // 设置后端使用的底层连接
+  // 设置后订阅变化以多主题 SUBSCRIBE / UNSUBSCRIBE 批量发送
+  // ========================
+  void setNetworkClient(Client* client) {
+    if (backend) backend->setTransport(client);
+  }
+
+  // ========================
+  // 设置网络接口（Wi-Fi / 以太网 / 主机 socket）
+  // 基于 Client 的后端绑定到 iface->client()，批量订阅也使用该连接；
+  // esp-mqtt 自带连接，只用接口判断链路状态
+  // ========================
+  void setNetworkInterface(NetInterface* iface) {
+    netInterface = iface;
+    // 发送窗口之间的 modem sleep 只对 Wi-Fi 链路有意义
+    txScheduler.setWiFiLink(iface == nullptr || strcmp(iface->name(), "wifi") == 0);
+    if (iface) {
+      if (backend) backend->setTransport(&iface->client());
+      if (debugEnabled) Serial.printf("✓ Network interface: %s\n", iface->name());
     }
   }
 
   // ========================
-  // 设置状态发布间隔
+  // 下次连接时强制重新订阅
+  // ========================
+  void forceResubscribe() {
+    sessionSubscribed = false;
+  }
+
+  // ========================
+  // 设置完整状态发布间隔
   // ========================
   void setStatusPublishInterval(uint32_t intervalMs) {
-    statusPublishInterval = intervalMs;
+    statusProfiles[STATUS_FULL].intervalMs = intervalMs;
+  }
+
+  // ========================
+  // 设置心跳发布间隔（0 表示关闭心跳）
+  // ========================
+  void setHeartbeatInterval(uint32_t intervalMs) {
+    statusProfiles[STATUS_HEARTBEAT].intervalMs = intervalMs;
+  }
+
+  // ========================
+  // 配置状态档位的字段和间隔
+  // ========================
+  void setStatusProfile(StatusProfileId id, uint32_t intervalMs, uint16_t fields, bool compactKeys) {
+    statusProfiles[id].intervalMs = intervalMs;
+    statusProfiles[id].fields = fields;
+    statusProfiles[id].compactKeys = compactKeys;
   }
 
   // ========================
@@ -215,93 +524,370 @@ public:
     autoStatusReport = enabled;
   }
 
+  // ========================
+  // 绑定设备影子
+  // 期望增量: <prefix>/<id>/shadow/desired
+  // 全量请求: <prefix>/<id>/shadow/get
+  // 上报增量: <prefix>/<id>/shadow/reported
+  // ========================
+  void attachShadow(DeviceShadow* deviceShadow, uint32_t minIntervalMs = 200) {
+    shadow = deviceShadow;
+    shadowMinInterval = minIntervalMs;
+    subscriptionsDirty = true;
+    if (shadow) {
+      shadow->markAllDirty();
+    }
+  }
+
+  // ========================
+  // 发布影子增量（仅包含变化的属性）
+  // ========================
+  bool publishShadow() {
+    if (!shadow || !isConnected()) {
+      return false;
+    }
+
+    PolicyJsonDocument doc(shadow->reportedCapacity());
+    lastShadowPublish = millis();
+    if (!shadow->buildReported(doc)) {
+      // 保留脏标记，下次再试
+      if (debugEnabled) Serial.println("✗ Shadow report overflowed, changes kept");
+      return false;
+    }
+
+    if (publishAs(ENERGY_STATUS, "shadow/reported", doc)) {
+      shadow->clearChanges();
+      return true;
+    }
+    return false;
+  }
+
   // ========================
   // 更新设备状态
   // ========================
   void updateStatus(const DeviceStatus& status) {
     deviceStatus = status;
     deviceStatus.uptime = millis() / 1000;
-    deviceStatus.signalStrength = getWiFiSignalStrength();
-    deviceStatus.ipAddress = getLocalIP();
+    deviceStatus.signalStrength = currentSignalStrength();
+    deviceStatus.ipAddress = currentLocalIP();
     deviceStatus.lastUpdateTime = millis();
   }
 
   // ========================
   // 发布自定义消息
+  // 返回 PUBLISH_SENT（已发送）、PUBLISH_QUEUED（等待发送窗口）或 PUBLISH_FAILED
   // ========================
-  bool publish(const char* topic, const char* message) {
+  PublishResult publish(const char* topic, const char* message, MessagePriority priority = PRIORITY_NORMAL) {
     if (!isConnected()) {
+      flightRecord(FR_EVT_PUBLISH_FAIL, strlen(message));
       if (debugEnabled) Serial.println("✗ MQTT not connected");
-      return false;
+      return PUBLISH_FAILED;
+    }
+
+    // 非紧急消息交给发送窗口
+    if (!flushingWindow && txScheduler.enqueue(topic, message, priority, txSubsystem)) {
+      return PUBLISH_QUEUED;
     }
 
     String fullTopic = buildTopic(topic);
-    bool result = mqttClient->publish(fullTopic.c_str(), message);
+    bool result = backend->publish(fullTopic.c_str(), (const uint8_t*)message, strlen(message), publishQos, false);
+    if (result) {
+      energy.recordTx(txSubsystem, topic, fullTopic.length() + strlen(message) + 4, priority);
+    } else {
+      flightRecord(FR_EVT_PUBLISH_FAIL, strlen(message));
+    }
     
     if (debugEnabled) {
       Serial.printf("✓ Published to %s: %s\n", fullTopic.c_str(), message);
     }
     
+    return result ? PUBLISH_SENT : PUBLISH_FAILED;
+  }
+
+  // ========================
+  // 发布二进制数据（如图像），立即发送，不进入发送窗口
+  // ========================
+  bool publishBinary(const char* topic, const uint8_t* data, size_t length) {
+    if (!isConnected()) {
+      flightRecord(FR_EVT_PUBLISH_FAIL, length);
+      return false;
+    }
+
+    String fullTopic = buildTopic(topic);
+    bool result = backend->publish(fullTopic.c_str(), data, length, publishQos, false);
+    if (result) {
+      energy.recordTx(txSubsystem, topic, fullTopic.length() + length + 4, PRIORITY_URGENT);
+    } else {
+      flightRecord(FR_EVT_PUBLISH_FAIL, length);
+    }
+
+    if (debugEnabled) {
+      Serial.printf("%s Published %u bytes to %s\n", result ? "✓" : "✗", (unsigned)length, fullTopic.c_str());
+    }
     return result;
   }
 
+  // ========================
+  // 发布并跟踪服务器确认，立即发送（不进入发送窗口）
+  // 返回值同 MqttBackend::publishTracked：>0 为报文 ID，确认经 setPublishAckHandler 回调；
+  // 0 表示已发出且不会有确认（QoS 0）；<0 表示失败
+  // ========================
+  int publishTracked(const char* topic, const char* message, uint8_t qos) {
+    if (!isConnected()) {
+      flightRecord(FR_EVT_PUBLISH_FAIL, strlen(message));
+      return -1;
+    }
+
+    uint8_t maxQos = backend->maxPublishQos();
+    String fullTopic = buildTopic(topic);
+    int msgId = backend->publishTracked(fullTopic.c_str(), (const uint8_t*)message, strlen(message),
+                                        qos > maxQos ? maxQos : qos, false);
+    if (msgId >= 0) {
+      energy.recordTx(txSubsystem, topic, fullTopic.length() + strlen(message) + 4, PRIORITY_URGENT);
+    } else {
+      flightRecord(FR_EVT_PUBLISH_FAIL, strlen(message));
+    }
+
+    if (debugEnabled) {
+      Serial.printf("%s Published to %s (msg id %d): %s\n", msgId >= 0 ? "✓" : "✗", fullTopic.c_str(), msgId, message);
+    }
+    return msgId;
+  }
+
+  // 发布确认回调（在 loop() 中调用）
+  void setPublishAckHandler(PublishAckHandler handler) {
+    if (backend) backend->setPublishAckHandler(handler);
+  }
+
+  // ========================
+  // 从任意 FreeRTOS 任务 / 定时器回调发布
+  // 消息拷贝进无锁队列，由调用 loop() 的任务发送；
+  // 队列满或主题 / 消息超出槽位长度（MQTT_QUEUED_*_LEN - 1）时返回 false，不截断
+  // ========================
+  bool publishFromTask(const char* topic, const char* message) {
+    if (!fitsPublishQueue(topic, message)) {
+      if (debugEnabled) Serial.printf("✗ Message too large for publish queue: %s\n", topic);
+      return false;
+    }
+    bool queued = enqueuePublish(topic, message);
+    if (!queued && debugEnabled) {
+      Serial.printf("✗ Publish queue full, dropped: %s\n", topic);
+    }
+    return queued;
+  }
+
+  // ========================
+  // 从中断中发布（位于 IRAM，不打印、不分配内存）
+  // ========================
+  bool IRAM_ATTR publishFromISR(const char* topic, const char* message) {
+    return enqueuePublish(topic, message);
+  }
+
+  // ========================
+  // 跨任务队列丢弃的消息数
+  // ========================
+  uint32_t getDroppedPublishCount() {
+    return publishQueue.droppedCount();
+  }
+
+  // ========================
+  // 接收路径临时内存的最高使用量（用于调整 MQTT_RECEIVE_ARENA_SIZE）
+  // ========================
+  size_t getReceiveArenaHighWater() {
+    return receiveArena.getHighWater();
+  }
+
   // ========================
   // 发布 JSON 消息
   // ========================
-  bool publishJson(const char* topic, JsonDocument& doc) {
+  PublishResult publishJson(const char* topic, JsonDocument& doc, MessagePriority priority = PRIORITY_NORMAL) {
     String message;
-    serializeJson(doc, message);
-    return publish(topic, message.c_str());
+    {
+      TRACE_SCOPE("json.serialize", "json");
+      serializeJson(doc, message);
+    }
+    return publish(topic, message.c_str(), priority);
+  }
+
+  // ========================
+  // 启用发送窗口：非紧急消息对齐到 periodMs 的窗口集中发送
+  // 窗口之间射频进入 modem sleep（仅 Wi-Fi 链路）；紧急消息（PRIORITY_URGENT）仍立即发送
+  // ========================
+  void enableTxWindows(uint32_t periodMs, bool modemSleep = true) {
+    txScheduler.begin(periodMs, modemSleep);
+  }
+
+  void disableTxWindows() {
+    if (txScheduler.pending() > 0 && isConnected()) {
+      flushTxWindow();
+    }
+    txScheduler.end();
   }
 
   // ========================
-  // 发布设备状态
+  // 设置某优先级的最大延迟（毫秒）
+  // ========================
+  void setTxLatencyBudget(MessagePriority priority, uint32_t budgetMs) {
+    txScheduler.setLatencyBudget(priority, budgetMs);
+  }
+
+  // ========================
+  // 设置能耗报告间隔（0 表示关闭）
+  // ========================
+  void setEnergyReportInterval(uint32_t intervalMs) {
+    energyReportInterval = intervalMs;
+  }
+
+  // ========================
+  // 能耗统计
+  // ========================
+  EnergyAccounting& getEnergyAccounting() {
+    return energy;
+  }
+
+  // ========================
+  // 发布能耗报告（按子系统 / 优先级 / 主题）
+  // ========================
+  bool publishEnergyReport() {
+    PolicyJsonDocument doc(768);
+    energy.buildReport(doc);
+    return publishAs(ENERGY_STATUS, "energy", doc, PRIORITY_BULK);
+  }
+
+  // ========================
+  // 发布启动耗时报告（各阶段起止时间和首条消息时间）
+  // ========================
+  bool publishBootReport() {
+    PolicyJsonDocument doc(BOOT_REPORT_CAPACITY);
+    bootProfiler.buildReport(doc);
+    if (doc.overflowed()) {
+      Serial.println("✗ Boot report exceeds document capacity");
+      return false;
+    }
+    return publishAs(ENERGY_STATUS, "boot", doc, PRIORITY_BULK);
+  }
+
+  // ========================
+  // 发布内存放置报告（各缓冲类别的 PSRAM / 内部 SRAM 占用，可选测量访问延迟）
+  // ========================
+  bool publishMemoryReport(bool withLatency = false) {
+    PolicyJsonDocument doc(512);
+    buildMemoryReport(doc, withLatency);
+    return publishAs(ENERGY_STATUS, "memory", doc, PRIORITY_BULK);
+  }
+
+  // ========================
+  // 发布完整设备状态
   // ========================
   bool publishStatus() {
+    return publishStatusProfile(STATUS_FULL);
+  }
+
+  // ========================
+  // 发布心跳
+  // ========================
+  bool publishHeartbeat() {
+    return publishStatusProfile(STATUS_HEARTBEAT);
+  }
+
+  // ========================
+  // 按档位发布状态
+  // ========================
+  bool publishStatusProfile(StatusProfileId id, MessagePriority priority) {
     if (!isConnected()) {
       return false;
     }
 
-    DynamicJsonDocument doc(512);
-    
-    doc["device_id"] = deviceStatus.deviceId;
-    doc["chip_type"] = deviceStatus.chipType;
-    doc["is_connected"] = deviceStatus.isConnected;
-    doc["uptime"] = deviceStatus.uptime;
-    doc["signal_strength"] = deviceStatus.signalStrength;
-    doc["ip_address"] = deviceStatus.ipAddress;
-    doc["timestamp"] = millis();
+    StatusProfile& profile = statusProfiles[id];
+    String ip = currentLocalIP();
+    StatusSnapshot snapshot;
+    snapshot.deviceId = deviceStatus.deviceId.c_str();
+    snapshot.chipType = deviceStatus.chipType.c_str();
+    snapshot.ipAddress = ip.c_str();
+    snapshot.isConnected = deviceStatus.isConnected;
+    snapshot.uptime = millis() / 1000;
+    snapshot.signalStrength = currentSignalStrength();
+    snapshot.freeHeap = ESP.getFreeHeap();
+
+    PolicyJsonDocument doc(profile.fields == STATUS_FIELD_ALL ? 512 : 128);
+    buildStatusPayload(doc, snapshot, profile.fields, profile.compactKeys);
+
+    // 任何一次发布都重新计时，按需请求后不会紧接着再自动发布
+    profile.lastPublish = millis();
+    return publishAs(ENERGY_STATUS, profile.subTopic, doc, priority);
+  }
 
-    String fullTopic = baseTopicPrefix + "/" + deviceStatus.deviceId + "/status";
-    return publishJson(fullTopic.c_str(), doc);
+  bool publishStatusProfile(StatusProfileId id) {
+    return publishStatusProfile(id, statusProfiles[id].priority);
   }
 
   // ========================
   // 发布上线消息
   // ========================
   void publishOnlineStatus() {
-    DynamicJsonDocument doc(256);
+    PolicyJsonDocument doc(256);
     doc["device_id"] = deviceStatus.deviceId;
     doc["status"] = "online";
     doc["timestamp"] = millis();
-    doc["ip_address"] = getLocalIP();
+    doc["ip_address"] = currentLocalIP();
     
-    String fullTopic = baseTopicPrefix + "/" + deviceStatus.deviceId + "/online";
-    publishJson(fullTopic.c_str(), doc);
+    publishAs(ENERGY_STATUS, "online", doc, PRIORITY_URGENT);
   }
 
   // ========================
   // 发布离线消息
   // ========================
   void publishOfflineStatus() {
-    DynamicJsonDocument doc(256);
+    PolicyJsonDocument doc(256);
     doc["device_id"] = deviceStatus.deviceId;
     doc["status"] = "offline";
     doc["timestamp"] = millis();
     
-    String fullTopic = baseTopicPrefix + "/" + deviceStatus.deviceId + "/offline";
+    String fullTopic = buildTopic("offline");
     // 离线消息可以设置 MQTT 遗嘱，这里简单发布
-    mqttClient->publish(fullTopic.c_str(), "{\"status\":\"offline\"}");
+    const char* offline = "{\"status\":\"offline\"}";
+    backend->publish(fullTopic.c_str(), (const uint8_t*)offline, strlen(offline), publishQos, false);
+  }
+
+  // ========================
+  // 发布上次启动的飞行记录（分片，避免超出客户端缓冲）
+  // ========================
+  bool publishFlightTrace() {
+    if (recoveredFlightEvents.empty()) {
+      return true;
+    }
+
+    const size_t perPart = 6;
+    size_t total = recoveredFlightEvents.size();
+    size_t parts = (total + perPart - 1) / perPart;
+
+    for (size_t part = 0; part < parts; part++) {
+      PolicyJsonDocument doc(512);
+      doc["boot_seq"] = recoveredFlightEvents[0].bootSeq;
+      doc["reset_reason"] = recoveredResetReason;
+      doc["part"] = part + 1;
+      doc["parts"] = parts;
+      JsonArray events = doc.createNestedArray("events");
+
+      for (size_t i = part * perPart; i < total && i < (part + 1) * perPart; i++) {
+        const FlightEvent& e = recoveredFlightEvents[i];
+        JsonArray item = events.createNestedArray();
+        item.add(e.timestampUs);
+        item.add(flightEventName(e.type));
+        item.add(e.value);
+      }
+
+      if (!publishAs(ENERGY_STATUS, "trace", doc, PRIORITY_BULK)) {
+        return false;
+      }
+    }
+
+    if (debugEnabled) {
+      Serial.printf("✓ Flight trace published: %u events\n", (unsigned)total);
+    }
+    recoveredFlightEvents.clear();
+    recoveredFlightEvents.shrink_to_fit();
+    return true;
   }
 
   // ========================
@@ -310,14 +896,13 @@ public:
   bool publishCommandResponse(const char* command, bool success, const char* message = "") {
     if (!isConnected()) return false;
 
-    DynamicJsonDocument doc(256);
+    PolicyJsonDocument doc(256);
     doc["command"] = command;
     doc["success"] = success;
     doc["message"] = message;
     doc["timestamp"] = millis();
     
-    String fullTopic = baseTopicPrefix + "/" + deviceStatus.deviceId + "/response";
-    return publishJson(fullTopic.c_str(), doc);
+    return publishJson("response", doc, PRIORITY_URGENT);
   }
 
   // ========================
@@ -329,7 +914,7 @@ public:
     Serial.println("╠════════════════════════════════╣");
     
     for (auto& topic : topics) {
-      String line = "║ " + topic.name;
+      String line = "║ " + String(topic.name.c_str());
       while (line.length() < 33) line += " ";
       line += "║";
       Serial.println(line);
@@ -376,16 +961,50 @@ private:
   // MQTT 消息处理（内部）
   // ========================
   void onMqttMessage(char* topic, byte* payload, unsigned int length) {
-    char message[256];
-    snprintf(message, sizeof(message), "%.*s", (int)length, (char*)payload);
+    TRACE_SCOPE("mqtt.onMessage", "mqtt");
+    energy.recordRx(strlen(topic) + length + 4);
+    // 消息内的所有临时数据都来自 receiveArena，不使用通用堆；
+    // 回调中再次进入时（如处理函数里调用 loop()）不能重置外层消息仍在使用的内存，只由最外层重置
+    bool outermost = receiveDepth == 0;
+    if (outermost) receiveArena.reset();
+    receiveDepth++;
+    dispatchMessage(topic, payload, length);
+    receiveDepth--;
+    if (outermost) receiveArena.reset();
+  }
+
+  // ========================
+  // 解析并分发单条消息
+  // ========================
+  void dispatchMessage(char* topic, byte* payload, unsigned int length) {
+    // 去掉 "<prefix>/<id>/" 前缀后按子主题匹配，避免逐个构建完整主题
+    const char* subTopic = stripTopicPrefix(topic);
+
+    // 按需状态请求（负载可以为空，不需要解析）
+    if (subTopic && strcmp(subTopic, "status/get") == 0) {
+      publishStatusProfile(STATUS_FULL, PRIORITY_URGENT);
+      return;
+    }
+
+    char* message = (char*)receiveArena.allocate(length + 1);
+    if (message == nullptr) {
+      if (debugEnabled) Serial.printf("✗ Message too large: %u bytes\n", length);
+      return;
+    }
+    memcpy(message, payload, length);
+    message[length] = '\0';
     
     if (debugEnabled) {
       Serial.printf("Message from topic [%s]: %s\n", topic, message);
     }
 
-    // 解析 JSON
-    DynamicJsonDocument doc(512);
-    DeserializationError error = deserializeJson(doc, message);
+    // 解析 JSON（以只读方式解析，保留原始消息给 message 回调）
+    ArenaJsonDocument doc(MQTT_RECEIVE_JSON_CAPACITY, ArenaJsonAllocator(&receiveArena));
+    DeserializationError error;
+    {
+      TRACE_SCOPE("json.parse", "json");
+      error = deserializeJson(doc, (const char*)message, length);
+    }
     
     if (error) {
       if (debugEnabled) {
@@ -394,40 +1013,231 @@ private:
       return;
     }
 
-    // 匹配主题并调用回调
+    // 设备影子主题
+    if (shadow && subTopic && routeShadowMessage(subTopic, doc)) {
+      return;
+    }
+
+    for (auto& observer : observers) {
+      observer(topic, doc);
+    }
+
+    // 未驻留的子主题不可能匹配任何已注册主题
+    InternedString id;
+    if (subTopic == nullptr || !InternedString::lookup(subTopic, id)) {
+      return;
+    }
+
+    // 匹配主题并调用回调（指针比较）
     for (auto& t : topics) {
-      String fullTopic = buildTopic(t.name.c_str());
-      if (strcmp(topic, fullTopic.c_str()) == 0) {
+      if (t.name == id) {
         // 如果有 command 字段，调用 command 回调
-        if (doc.containsKey("command") && t.onCommand != nullptr) {
-          String command = doc["command"].as<String>();
-          t.onCommand(command.c_str(), doc);
+        TRACE_SCOPE("handler", "handler");
+        uint32_t handlerStart = micros();
+        const char* command = doc["command"];
+        if (command != nullptr && t.onCommand != nullptr) {
+          t.onCommand(command, doc);
         }
         // 否则调用 message 回调
         else if (t.onMessage != nullptr) {
           t.onMessage(topic, message);
         }
+        uint32_t handlerTime = micros() - handlerStart;
+        if (handlerTime >= FLIGHT_HANDLER_THRESHOLD_US) {
+          flightRecord(FR_EVT_HANDLER_TIME, handlerTime);
+        }
         return;
       }
     }
   }
 
   // ========================
-  // 订阅所有注册的主题
+  // 返回去掉 "<prefix>/<id>/" 后的子主题，不属于本设备时返回 nullptr
+  // ========================
+  const char* stripTopicPrefix(const char* topic) {
+    size_t prefixLen = baseTopicPrefix.length();
+    size_t idLen = deviceStatus.deviceId.length();
+    if (strncmp(topic, baseTopicPrefix.c_str(), prefixLen) != 0 || topic[prefixLen] != '/') {
+      return nullptr;
+    }
+    topic += prefixLen + 1;
+    if (strncmp(topic, deviceStatus.deviceId.c_str(), idLen) != 0 || topic[idLen] != '/') {
+      return nullptr;
+    }
+    return topic + idLen + 1;
+  }
+
+  // ========================
+  // 处理影子主题，返回是否已处理
   // ========================
-  void subscribeToAllTopics() {
+  bool routeShadowMessage(const char* subTopic, JsonDocument& doc) {
+    if (strcmp(subTopic, "shadow/desired") == 0) {
+      shadow->applyDesired(doc);
+      return true;
+    }
+    if (strcmp(subTopic, "shadow/get") == 0) {
+      shadow->markAllDirty();
+      return true;
+    }
+    return false;
+  }
+
+  // ========================
+  // 以指定子系统的名义发布（用于能耗归属）
+  // ========================
+  PublishResult publishAs(EnergySubsystem subsystem, const char* topic, JsonDocument& doc,
+                          MessagePriority priority = PRIORITY_NORMAL) {
+    txSubsystem = subsystem;
+    PublishResult result = publishJson(topic, doc, priority);
+    txSubsystem = ENERGY_PUBLISH;
+    return result;
+  }
+
+  // ========================
+  // 发送窗口内的全部消息（共享一次射频唤醒）
+  // ========================
+  void flushTxWindow() {
+    ScheduledQueue batch = txScheduler.openWindow();
+    flushingWindow = true;
+    energy.beginBurst();
+
+    for (auto& msg : batch) {
+      txSubsystem = (EnergySubsystem)msg.tag;
+      publish(msg.topic.c_str(), msg.payload.c_str(), msg.priority);
+    }
+    txSubsystem = ENERGY_PUBLISH;
+
+    energy.endBurst();
+    flushingWindow = false;
+    txScheduler.closeWindow();
+
+    if (debugEnabled) {
+      Serial.printf("✓ TX window flushed: %u messages\n", (unsigned)batch.size());
+    }
+  }
+
+  // ========================
+  // 当前网络接口的信号强度 / IP
+  // ========================
+  int currentSignalStrength() {
+    return netInterface ? netInterface->signalStrength() : getWiFiSignalStrength();
+  }
+
+  String currentLocalIP() {
+    return netInterface ? netInterface->localIP() : getLocalIP();
+  }
+
+  static bool IRAM_ATTR fitsPublishQueue(const char* topic, const char* message) {
+    return strlen(topic) < MQTT_QUEUED_TOPIC_LEN && strlen(message) < MQTT_QUEUED_PAYLOAD_LEN;
+  }
+
+  // ========================
+  // 写入跨任务发布队列（中断中也会调用：只用 IRAM 中的队列操作和 ROM 中的字符串函数）
+  // ========================
+  bool IRAM_ATTR enqueuePublish(const char* topic, const char* message) {
+    size_t topicLen = strlen(topic);
+    size_t payloadLen = strlen(message);
+    if (topicLen >= MQTT_QUEUED_TOPIC_LEN || payloadLen >= MQTT_QUEUED_PAYLOAD_LEN) {
+      return false;
+    }
+
+    size_t pos;
+    if (!publishQueue.tryReserve(pos)) return false;
+    QueuedPublish& slot = publishQueue.slotAt(pos);
+    memcpy(slot.topic, topic, topicLen + 1);
+    memcpy(slot.payload, message, payloadLen + 1);
+    publishQueue.commit(pos);
+    return true;
+  }
+
+  // ========================
+  // 发送队列中的消息（每轮最多一个队列长度，避免阻塞 loop）
+  // ========================
+  void drainPublishQueue() {
+    QueuedPublish item;
+    for (size_t i = 0; i < MQTT_PUBLISH_QUEUE_SIZE && publishQueue.tryPop(item); i++) {
+      publish(item.topic, item.payload);
+    }
+  }
+
+  // ========================
+  // 期望的完整订阅列表
+  // ========================
+  std::vector<String> desiredSubscriptions() {
+    std::vector<String> wanted;
+    wanted.reserve(topics.size() + 3);
+    wanted.push_back(buildTopic("status/get"));
+    if (shadow) {
+      wanted.push_back(buildTopic("shadow/desired"));
+      wanted.push_back(buildTopic("shadow/get"));
+    }
     for (auto& topic : topics) {
-      String fullTopic = buildTopic(topic.name.c_str());
-      if (mqttClient->subscribe(fullTopic.c_str())) {
-        if (debugEnabled) {
-          Serial.println("✓ Subscribed to: " + fullTopic);
-        }
-      } else {
-        if (debugEnabled) {
-          Serial.println("✗ Subscribe failed: " + fullTopic);
-        }
+      wanted.push_back(buildTopic(topic.name.c_str()));
+    }
+    return wanted;
+  }
+
+  // ========================
+  // 同步订阅：只发送与服务器端订阅的差异
+  // ========================
+  bool syncSubscriptions() {
+    if (!isConnected()) {
+      subscriptionsDirty = true;
+      return false;
+    }
+
+    std::vector<String> wanted = desiredSubscriptions();
+    std::vector<String> toSubscribe;
+    std::vector<String> toUnsubscribe;
+
+    for (auto& t : wanted) {
+      if (std::find(activeSubscriptions.begin(), activeSubscriptions.end(), t) == activeSubscriptions.end()) {
+        toSubscribe.push_back(t);
       }
     }
+    for (auto& t : activeSubscriptions) {
+      if (std::find(wanted.begin(), wanted.end(), t) == wanted.end()) {
+        toUnsubscribe.push_back(t);
+      }
+    }
+
+    // 持久会话使用 QoS 1，离线期间的消息由服务器排队
+    uint8_t qos = persistentSession ? 1 : 0;
+    bool subOk = sendSubscriptions(MQTT_PACKET_SUBSCRIBE, toSubscribe, qos);
+    bool unsubOk = sendSubscriptions(MQTT_PACKET_UNSUBSCRIBE, toUnsubscribe, qos);
+
+    if (debugEnabled && (!toSubscribe.empty() || !toUnsubscribe.empty())) {
+      Serial.printf("%s Subscriptions synced: +%u -%u\n", subOk && unsubOk ? "✓" : "✗",
+                    (unsigned)toSubscribe.size(), (unsigned)toUnsubscribe.size());
+    }
+
+    if (subOk && unsubOk) {
+      activeSubscriptions = wanted;
+      subscriptionsDirty = false;
+      return true;
+    }
+    subscriptionsDirty = true;
+    return false;
+  }
+
+  // ========================
+  // 发送订阅变化（是否批量由后端决定）
+  // ========================
+  bool sendSubscriptions(uint8_t packetType, const std::vector<String>& filters, uint8_t qos) {
+    if (filters.empty()) {
+      return true;
+    }
+    uint32_t bytes = 0;
+    for (auto& t : filters) bytes += t.length() + 3;
+    energy.recordTx(ENERGY_SUBSCRIBE, nullptr, bytes);
+
+    bool ok = packetType == MQTT_PACKET_SUBSCRIBE
+                ? backend->subscribe(filters, qos)
+                : backend->unsubscribe(filters);
+    if (!ok && debugEnabled) {
+      Serial.printf("✗ Subscription update failed (%u topics)\n", (unsigned)filters.size());
+    }
+    return ok;
   }
 
   // ========================
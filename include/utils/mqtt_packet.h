@@ -0,0 +1,92 @@
+// include/mqtt_packet.h
+#ifndef MQTT_PACKET_H
+#define MQTT_PACKET_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include <vector>
+
+// ========================
+// MQTT 3.1.1 多主题 SUBSCRIBE / UNSUBSCRIBE 报文编码
+// PubSubClient 每个报文只能带一个主题，这里直接写入底层 Client，
+// 一个报文携带多个主题过滤器。SUBACK / UNSUBACK 由 PubSubClient 忽略。
+// ========================
+#define MQTT_PACKET_SUBSCRIBE   0x82
+#define MQTT_PACKET_UNSUBSCRIBE 0xA2
+#define MQTT_BATCH_MAX_BYTES    1024   // 单个批量报文的最大长度
+
+// 使用高位报文 ID，避免与 PubSubClient 内部计数冲突
+uint16_t mqttBatchPacketId = 0x8000;
+
+inline uint16_t mqttNextBatchPacketId() {
+  mqttBatchPacketId++;
+  if (mqttBatchPacketId == 0) mqttBatchPacketId = 0x8000;
+  return mqttBatchPacketId;
+}
+
+// ========================
+// 编码剩余长度（变长整数）
+// ========================
+inline void mqttAppendRemainingLength(std::vector<uint8_t>& out, size_t length) {
+  do {
+    uint8_t digit = length % 128;
+    length /= 128;
+    if (length > 0) digit |= 0x80;
+    out.push_back(digit);
+  } while (length > 0);
+}
+
+// ========================
+// 构建一个批量报文，返回下一个未编码的主题下标
+// ========================
+size_t mqttBuildBatch(std::vector<uint8_t>& out, uint8_t packetType, const std::vector<String>& filters,
+                      size_t start, uint8_t qos) {
+  bool withQos = packetType == MQTT_PACKET_SUBSCRIBE;
+  size_t body = 2;
+  size_t end = start;
+
+  while (end < filters.size()) {
+    size_t entry = 2 + filters[end].length() + (withQos ? 1 : 0);
+    if (end > start && body + entry + 5 > MQTT_BATCH_MAX_BYTES) break;
+    body += entry;
+    end++;
+  }
+
+  uint16_t packetId = mqttNextBatchPacketId();
+  out.clear();
+  out.reserve(body + 5);
+  out.push_back(packetType);
+  mqttAppendRemainingLength(out, body);
+  out.push_back(packetId >> 8);
+  out.push_back(packetId & 0xFF);
+
+  for (size_t i = start; i < end; i++) {
+    uint16_t len = filters[i].length();
+    out.push_back(len >> 8);
+    out.push_back(len & 0xFF);
+    out.insert(out.end(), filters[i].c_str(), filters[i].c_str() + len);
+    if (withQos) out.push_back(qos);
+  }
+  return end;
+}
+
+// ========================
+// 发送批量订阅 / 取消订阅（必要时拆成多个报文）
+// ========================
+bool mqttSendBatch(Client* client, uint8_t packetType, const std::vector<String>& filters, uint8_t qos = 0) {
+  if (client == nullptr || filters.empty()) {
+    return filters.empty();
+  }
+
+  std::vector<uint8_t> packet;
+  size_t next = 0;
+  while (next < filters.size()) {
+    next = mqttBuildBatch(packet, packetType, filters, next, qos);
+    if (client->write(packet.data(), packet.size()) != packet.size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif
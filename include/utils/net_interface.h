@@ -0,0 +1,173 @@
+// include/net_interface.h
+#ifndef NET_INTERFACE_H
+#define NET_INTERFACE_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+// ========================
+// 网络接口抽象
+// MQTTManager 通过它获取 TCP Client、链路状态、信号强度和 IP，
+// 不再假定一定是 Wi-Fi
+// ========================
+class NetInterface {
+public:
+  virtual ~NetInterface() {}
+  virtual const char* name() = 0;         // "wifi" / "eth" / "host"
+  virtual bool begin() = 0;               // 启动链路（Wi-Fi 由 WiFiManager 负责时直接返回状态）
+  virtual bool isUp() = 0;                // 链路已就绪（有 IP）
+  virtual int signalStrength() = 0;       // dBm，有线接口返回 0
+  virtual String localIP() = 0;
+  virtual Client& client() = 0;           // 供 PubSubClient 使用的 TCP 连接
+};
+
+// ========================
+// Wi-Fi
+// ========================
+#if defined(ESP32) || defined(ESP8266)
+
+#ifdef ESP32
+  #include <WiFi.h>
+#else
+  #include <ESP8266WiFi.h>
+#endif
+
+// ========================
+// 连接成功后关闭 Nagle：socket 在 connect() 时才创建，之前调用 setNoDelay 无效
+// ========================
+class NoDelayWiFiClient : public WiFiClient {
+public:
+  using WiFiClient::connect;
+
+  int connect(IPAddress ip, uint16_t port) override {
+    int result = WiFiClient::connect(ip, port);
+    if (result > 0) setNoDelay(true);
+    return result;
+  }
+
+  int connect(const char* host, uint16_t port) override {
+    int result = WiFiClient::connect(host, port);
+    if (result > 0) setNoDelay(true);
+    return result;
+  }
+};
+
+class WiFiNetInterface : public NetInterface {
+private:
+  NoDelayWiFiClient tcp;
+
+public:
+  const char* name() override { return "wifi"; }
+
+  bool begin() override {
+    return isUp();
+  }
+
+  bool isUp() override { return WiFi.status() == WL_CONNECTED; }
+  int signalStrength() override { return WiFi.RSSI(); }
+  String localIP() override { return WiFi.localIP().toString(); }
+  Client& client() override { return tcp; }
+};
+
+#endif
+
+// ========================
+// 有线以太网：LAN8720（ESP32 内置 EMAC，定义 NET_ETH_LAN8720）
+// ========================
+#if defined(ESP32) && defined(NET_ETH_LAN8720)
+
+#include <ETH.h>
+
+class EthernetNetInterface : public NetInterface {
+private:
+  NoDelayWiFiClient tcp;          // ESP32 上 WiFiClient 基于 lwIP socket，同样可走以太网
+
+public:
+  const char* name() override { return "eth"; }
+
+  bool begin() override {
+    // 引脚和 PHY 参数使用板级默认值（ETH_PHY_ADDR / ETH_PHY_MDC / ...）
+    if (!ETH.begin()) {
+      return false;
+    }
+    return true;
+  }
+
+  bool isUp() override { return ETH.linkUp() && ETH.localIP() != IPAddress(0, 0, 0, 0); }
+  int signalStrength() override { return 0; }
+  String localIP() override { return ETH.localIP().toString(); }
+  Client& client() override { return tcp; }
+};
+
+// ========================
+// 有线以太网：W5500（SPI，Arduino Ethernet 库，定义 NET_ETH_W5500）
+// ========================
+#elif defined(NET_ETH_W5500)
+
+#include <SPI.h>
+#include <Ethernet.h>
+
+#ifndef NET_W5500_CS_PIN
+  #define NET_W5500_CS_PIN 5
+#endif
+
+class EthernetNetInterface : public NetInterface {
+private:
+  EthernetClient tcp;
+  uint8_t mac[6];
+
+public:
+  EthernetNetInterface() {
+    // 由芯片 ID 派生本地管理的 MAC 地址
+    #ifdef ESP32
+      uint64_t id = ESP.getEfuseMac();
+    #else
+      uint64_t id = ESP.getChipId();
+    #endif
+    mac[0] = 0x02;
+    for (int i = 1; i < 6; i++) {
+      mac[i] = (id >> (8 * (i - 1))) & 0xFF;
+    }
+  }
+
+  const char* name() override { return "eth"; }
+
+  bool begin() override {
+    Ethernet.init(NET_W5500_CS_PIN);
+    return Ethernet.begin(mac) != 0;
+  }
+
+  bool isUp() override { return Ethernet.linkStatus() == LinkON; }
+  int signalStrength() override { return 0; }
+  String localIP() override {
+    IPAddress ip = Ethernet.localIP();
+    return String(ip[0]) + "." + String(ip[1]) + "." + String(ip[2]) + "." + String(ip[3]);
+  }
+  Client& client() override { return tcp; }
+};
+
+#endif
+
+// ========================
+// 主机构建：BSD socket（仓库中没有主机构建环境，此分支未经编译测试）
+// ========================
+#ifndef ARDUINO
+
+#include "posix_socket_client.h"
+
+class HostNetInterface : public NetInterface {
+private:
+  PosixSocketClient tcp;
+
+public:
+  const char* name() override { return "host"; }
+  bool begin() override { return true; }
+  bool isUp() override { return true; }
+  int signalStrength() override { return 0; }
+  String localIP() override { return "127.0.0.1"; }
+  Client& client() override { return tcp; }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,171 @@
+// include/posix_socket_client.h
+#ifndef POSIX_SOCKET_CLIENT_H
+#define POSIX_SOCKET_CLIENT_H
+
+// ========================
+// 主机构建使用的 BSD socket Client 实现
+// 让 PubSubClient / MQTTManager 在主机上连接本地 broker
+// 仓库内没有主机构建环境，需自行提供 Arduino.h / Client.h 兼容层，未经测试
+// ========================
+#ifndef ARDUINO
+
+#include <Arduino.h>
+#include <Client.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+class PosixSocketClient : public Client {
+private:
+  int fd;
+  int peeked;                     // peek() 缓存的字节，-1 表示无
+
+public:
+  PosixSocketClient() : fd(-1), peeked(-1) {}
+
+  ~PosixSocketClient() {
+    stop();
+  }
+
+  int connect(IPAddress ip, uint16_t port) override {
+    return connect(ip.toString().c_str(), port);
+  }
+
+  int connect(const char* host, uint16_t port) override {
+    stop();
+
+    char portStr[8];
+    snprintf(portStr, sizeof(portStr), "%u", port);
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host, portStr, &hints, &result) != 0) {
+      return 0;
+    }
+
+    for (struct addrinfo* ai = result; ai != nullptr; ai = ai->ai_next) {
+      fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (fd < 0) continue;
+      if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+      ::close(fd);
+      fd = -1;
+    }
+    freeaddrinfo(result);
+
+    if (fd < 0) {
+      return 0;
+    }
+
+    // MQTT 报文小而频繁，关闭 Nagle
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return 1;
+  }
+
+  size_t write(uint8_t b) override {
+    return write(&b, 1);
+  }
+
+  size_t write(const uint8_t* buf, size_t size) override {
+    if (fd < 0) return 0;
+    size_t sent = 0;
+    while (sent < size) {
+      ssize_t n = ::send(fd, buf + sent, size - sent, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) {
+        stop();
+        break;
+      }
+      sent += n;
+    }
+    return sent;
+  }
+
+  int available() override {
+    if (fd < 0) return 0;
+    int pending = 0;
+    if (ioctl(fd, FIONREAD, &pending) < 0) return 0;
+    return pending + (peeked >= 0 ? 1 : 0);
+  }
+
+  int read() override {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+  }
+
+  int read(uint8_t* buf, size_t size) override {
+    if (fd < 0 || size == 0) return -1;
+    size_t offset = 0;
+    if (peeked >= 0) {
+      buf[offset++] = (uint8_t)peeked;
+      peeked = -1;
+      if (offset == size) return offset;
+    }
+    ssize_t n = ::recv(fd, buf + offset, size - offset, MSG_DONTWAIT);
+    if (n == 0) {
+      stop();
+      return offset > 0 ? (int)offset : -1;
+    }
+    if (n < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) stop();
+      return offset > 0 ? (int)offset : -1;
+    }
+    return offset + n;
+  }
+
+  int peek() override {
+    if (peeked < 0) {
+      uint8_t b;
+      if (fd >= 0 && ::recv(fd, &b, 1, MSG_DONTWAIT) == 1) peeked = b;
+    }
+    return peeked;
+  }
+
+  void flush() override {
+  }
+
+  void stop() override {
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+    peeked = -1;
+  }
+
+  uint8_t connected() override {
+    if (fd < 0) return 0;
+    if (peeked >= 0) return 1;
+
+    // 对端关闭时 poll 可读且 recv 返回 0
+    struct pollfd p = {fd, POLLIN, 0};
+    if (::poll(&p, 1, 0) > 0 && (p.revents & (POLLIN | POLLHUP))) {
+      uint8_t b;
+      ssize_t n = ::recv(fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+      if (n == 0) {
+        stop();
+        return 0;
+      }
+    }
+    return 1;
+  }
+
+  operator bool() override {
+    return fd >= 0;
+  }
+
+  int socketFd() {
+    return fd;
+  }
+};
+
+#endif
+
+#endif
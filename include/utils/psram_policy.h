@@ -0,0 +1,313 @@
+// include/psram_policy.h
+#ifndef PSRAM_POLICY_H
+#define PSRAM_POLICY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include <stdlib.h>
+
+#ifdef ESP32
+  #include <esp_heap_caps.h>
+  #if __has_include(<esp_memory_utils.h>)
+    #include <esp_memory_utils.h>
+  #else
+    #include <soc/soc_memory_layout.h>
+  #endif
+#else
+  #include <malloc.h>
+#endif
+
+// ========================
+// 缓冲类别
+// ========================
+enum BufferClass : uint8_t {
+  BUF_JSON = 0,                   // JSON 文档
+  BUF_PUBLISH_QUEUE,              // 发布队列 / 发送窗口缓存
+  BUF_FRAME,                      // 摄像头帧、缩略图
+  BUF_LOG,                        // 日志 / 存储写缓冲
+  BUF_DSP,                        // FFT 等数值计算工作区
+  BUF_NETWORK,                    // 收发缓冲（DMA / lwIP 相关）
+  BUF_CLASS_COUNT
+};
+
+// ========================
+// 放置策略
+// ========================
+enum BufferPlacement : uint8_t {
+  PLACE_INTERNAL = 0,             // 内部 SRAM（低延迟）
+  PLACE_PSRAM,                    // PSRAM（大、长期存在、访问不频繁）
+  PLACE_PSRAM_IF_LARGE,           // 超过阈值时放 PSRAM
+  PLACE_INTERNAL_DMA              // 内部 DMA 可用内存（外设直接读写，如 SD 写缓冲）
+};
+
+struct BufferPolicy {
+  BufferPlacement placement;
+  uint32_t largeThreshold;        // PLACE_PSRAM_IF_LARGE 的阈值（字节）
+};
+
+// 多个任务同时分配 / 释放，计数器用原子操作
+struct BufferClassStats {
+  std::atomic<uint32_t> allocations;
+  std::atomic<uint32_t> fallbacks;    // 首选位置（PSRAM / DMA 内存）不可用或不足而放入普通内部 SRAM
+  std::atomic<int32_t> psramBytes;    // 当前在 PSRAM 中的字节数（即省出的内部堆）
+  std::atomic<int32_t> internalBytes;
+};
+
+// ========================
+// 全局策略表（默认：大块或长期数据进 PSRAM，延迟敏感的数值计算和网络缓冲留在内部 SRAM）
+// SD 写缓冲由 sdmmc 直接 DMA 读取；放在 PSRAM 时驱动每次经 512 字节的内部中转缓冲逐扇区拷贝，
+// 因此 BUF_LOG 默认放内部 DMA 内存，用内部堆换写卡吞吐
+// ========================
+BufferPolicy bufferPolicies[BUF_CLASS_COUNT] = {
+  {PLACE_PSRAM_IF_LARGE, 1024},   // BUF_JSON
+  {PLACE_PSRAM, 0},               // BUF_PUBLISH_QUEUE
+  {PLACE_PSRAM, 0},               // BUF_FRAME
+  {PLACE_INTERNAL_DMA, 0},        // BUF_LOG
+  {PLACE_INTERNAL, 0},            // BUF_DSP
+  {PLACE_INTERNAL, 0}             // BUF_NETWORK
+};
+
+BufferClassStats bufferStats[BUF_CLASS_COUNT];
+
+inline void setBufferPolicy(BufferClass cls, BufferPlacement placement, uint32_t largeThreshold = 0) {
+  bufferPolicies[cls].placement = placement;
+  bufferPolicies[cls].largeThreshold = largeThreshold;
+}
+
+inline bool psramAvailable() {
+  #ifdef ESP32
+    return heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+  #else
+    return false;
+  #endif
+}
+
+inline bool wantsPsram(BufferClass cls, size_t size) {
+  const BufferPolicy& p = bufferPolicies[cls];
+  return p.placement == PLACE_PSRAM || (p.placement == PLACE_PSRAM_IF_LARGE && size >= p.largeThreshold);
+}
+
+inline size_t allocatedSize(void* ptr) {
+  #ifdef ESP32
+    return heap_caps_get_allocated_size(ptr);
+  #else
+    return malloc_usable_size(ptr);
+  #endif
+}
+
+inline bool isPsramPointer(void* ptr) {
+  #ifdef ESP32
+    return esp_ptr_external_ram(ptr);
+  #else
+    (void)ptr;
+    return false;
+  #endif
+}
+
+// ========================
+// 按类别分配 / 释放
+// ========================
+inline void* memAlloc(BufferClass cls, size_t size) {
+  BufferClassStats& s = bufferStats[cls];
+  void* ptr = nullptr;
+
+  #ifdef ESP32
+    if (wantsPsram(cls, size)) {
+      ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+      if (ptr == nullptr) s.fallbacks++;
+    } else if (bufferPolicies[cls].placement == PLACE_INTERNAL_DMA) {
+      ptr = heap_caps_malloc(size, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+      if (ptr == nullptr) s.fallbacks++;
+    }
+    if (ptr == nullptr) {
+      ptr = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+  #else
+    if (wantsPsram(cls, size)) s.fallbacks++;
+    ptr = malloc(size);
+  #endif
+
+  if (ptr) {
+    s.allocations++;
+    if (isPsramPointer(ptr)) s.psramBytes += (int32_t)allocatedSize(ptr);
+    else s.internalBytes += (int32_t)allocatedSize(ptr);
+  }
+  return ptr;
+}
+
+inline void memFree(BufferClass cls, void* ptr) {
+  if (ptr == nullptr) return;
+  BufferClassStats& s = bufferStats[cls];
+  if (isPsramPointer(ptr)) s.psramBytes -= (int32_t)allocatedSize(ptr);
+  else s.internalBytes -= (int32_t)allocatedSize(ptr);
+  free(ptr);
+}
+
+inline void* memRealloc(BufferClass cls, void* ptr, size_t size) {
+  if (ptr == nullptr) return memAlloc(cls, size);
+  void* fresh = memAlloc(cls, size);
+  if (fresh == nullptr) return nullptr;
+  size_t old = allocatedSize(ptr);
+  memcpy(fresh, ptr, old < size ? old : size);
+  memFree(cls, ptr);
+  return fresh;
+}
+
+// ========================
+// ArduinoJson 分配器
+// ========================
+template <BufferClass CLS>
+struct PolicyJsonAllocator {
+  void* allocate(size_t size) { return memAlloc(CLS, size); }
+  void deallocate(void* ptr) { memFree(CLS, ptr); }
+  void* reallocate(void* ptr, size_t size) { return memRealloc(CLS, ptr, size); }
+};
+
+typedef BasicJsonDocument<PolicyJsonAllocator<BUF_JSON> > PolicyJsonDocument;
+
+// ========================
+// STL 分配器（std::vector 等）
+// ========================
+template <typename T, BufferClass CLS>
+struct PolicyAllocator {
+  typedef T value_type;
+
+  PolicyAllocator() {}
+  template <typename U>
+  PolicyAllocator(const PolicyAllocator<U, CLS>&) {}
+
+  template <typename U>
+  struct rebind {
+    typedef PolicyAllocator<U, CLS> other;
+  };
+
+  T* allocate(size_t n) {
+    void* p = memAlloc(CLS, n * sizeof(T));
+    if (p == nullptr) abort();
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, size_t) {
+    memFree(CLS, p);
+  }
+
+  template <typename U>
+  bool operator==(const PolicyAllocator<U, CLS>&) const { return true; }
+  template <typename U>
+  bool operator!=(const PolicyAllocator<U, CLS>&) const { return false; }
+};
+
+// ========================
+// 访问延迟测量：缓冲分别放在内部 SRAM 和 PSRAM，
+// 顺序写 + 按缓存行跨步读若干遍，返回每 KB 的耗时（微秒）
+// PSRAM 经 32 KB 的 flash/PSRAM 缓存访问，缓冲必须远大于缓存才能测到真实延迟；
+// 内部 SRAM 不经缓存，用较小的缓冲即可（按 KB 归一化后可直接比较）
+// ========================
+#define MEM_LATENCY_PSRAM_BYTES 131072
+#define MEM_LATENCY_SRAM_BYTES 16384
+#define MEM_LATENCY_STRIDE 32           // 缓存行大小
+struct MemoryLatency {
+  float internalUsPerKB;
+  float psramUsPerKB;
+};
+
+inline float measureAccessUsPerKB(uint8_t* buf, size_t size, uint8_t passes) {
+  uint32_t start = micros();
+  volatile uint32_t sink = 0;
+  for (uint8_t p = 0; p < passes; p++) {
+    memset(buf, p, size);
+    // 每个缓存行只读一个字，先读完所有行的第一个字再读第二个，每次读取都落在不同的行
+    uint32_t sum = 0;
+    const uint32_t* words = (const uint32_t*)buf;
+    const size_t wordsPerLine = MEM_LATENCY_STRIDE / 4;
+    for (size_t w = 0; w < wordsPerLine; w++) {
+      for (size_t i = w; i < size / 4; i += wordsPerLine) sum += words[i];
+    }
+    sink = sink + sum;
+  }
+  (void)sink;
+  return (micros() - start) * 1024.0f / ((float)size * passes);
+}
+
+inline MemoryLatency measureMemoryLatency(size_t psramSize = MEM_LATENCY_PSRAM_BYTES,
+                                          size_t sramSize = MEM_LATENCY_SRAM_BYTES, uint8_t passes = 4) {
+  MemoryLatency result = {0, 0};
+  #ifdef ESP32
+    uint8_t* internal = (uint8_t*)heap_caps_malloc(sramSize, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    uint8_t* external = (uint8_t*)heap_caps_malloc(psramSize, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  #else
+    uint8_t* internal = (uint8_t*)malloc(sramSize);
+    uint8_t* external = nullptr;
+  #endif
+  if (internal) result.internalUsPerKB = measureAccessUsPerKB(internal, sramSize, passes);
+  if (external) result.psramUsPerKB = measureAccessUsPerKB(external, psramSize, passes);
+  free(internal);
+  free(external);
+  return result;
+}
+
+// ========================
+// 内存报告：各类别的放置情况、内部堆 / PSRAM 余量和访问延迟
+// dma_internal：为 DMA 留在内部堆的字节数（放 PSRAM 可省下，但写卡要经中转缓冲拷贝）
+// ========================
+inline int32_t dmaInternalBytes() {
+  int32_t bytes = 0;
+  for (uint8_t i = 0; i < BUF_CLASS_COUNT; i++) {
+    if (bufferPolicies[i].placement == PLACE_INTERNAL_DMA) bytes += bufferStats[i].internalBytes.load();
+  }
+  return bytes;
+}
+
+inline void buildMemoryReport(JsonDocument& doc, bool withLatency = false) {
+  static const char* names[BUF_CLASS_COUNT] = {"json", "queue", "frame", "log", "dsp", "net"};
+
+  #ifdef ESP32
+    doc["internal_free"] = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    doc["internal_min"] = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    doc["psram_free"] = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  #endif
+
+  int32_t saved = 0;
+  JsonObject classes = doc.createNestedObject("classes");
+  for (uint8_t i = 0; i < BUF_CLASS_COUNT; i++) {
+    const BufferClassStats& s = bufferStats[i];
+    uint32_t allocations = s.allocations.load();
+    if (allocations == 0) continue;
+    int32_t psramBytes = s.psramBytes.load();
+    uint32_t fallbacks = s.fallbacks.load();
+    JsonObject c = classes.createNestedObject(names[i]);
+    c["n"] = allocations;
+    c["psram"] = psramBytes;
+    c["internal"] = s.internalBytes.load();
+    if (fallbacks) c["fallback"] = fallbacks;
+    if (bufferPolicies[i].placement == PLACE_INTERNAL_DMA) c["dma"] = true;
+    saved += psramBytes;
+  }
+  doc["internal_saved"] = saved;
+  doc["dma_internal"] = dmaInternalBytes();
+
+  if (withLatency) {
+    MemoryLatency lat = measureMemoryLatency();
+    doc["sram_us_kb"] = lat.internalUsPerKB;
+    doc["psram_us_kb"] = lat.psramUsPerKB;
+  }
+}
+
+inline void printMemoryReport() {
+  MemoryLatency lat = measureMemoryLatency();
+  Serial.println("\n=== Memory Placement ===");
+  #ifdef ESP32
+    Serial.printf("Internal free: %u (min %u)\n", (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+                  (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+    Serial.printf("PSRAM free: %u\n", (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+  #endif
+  int32_t saved = 0;
+  for (uint8_t i = 0; i < BUF_CLASS_COUNT; i++) saved += bufferStats[i].psramBytes.load();
+  Serial.printf("Internal heap saved: %d bytes\n", (int)saved);
+  Serial.printf("DMA buffers in internal heap: %d bytes (PSRAM would free them, but SD writes would go through a 512 B bounce buffer)\n",
+                (int)dmaInternalBytes());
+  Serial.printf("Access: SRAM %.1f us/KB, PSRAM %.1f us/KB\n", lat.internalUsPerKB, lat.psramUsPerKB);
+}
+
+#endif
@@ -0,0 +1,84 @@
+// include/sample_ring.h
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// ========================
+// 单生产者单消费者无锁采样环形缓冲
+// 采集任务写入、处理任务读取，两端各自只修改自己的索引；
+// 满时丢弃新数据并计入溢出，不阻塞采集。N 必须是 2 的幂。
+// ========================
+template <typename T, size_t N>
+class SampleRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SampleRing size must be a power of two");
+
+private:
+  T buffer[N];
+  std::atomic<size_t> head;         // 生产者写入位置（单调递增）
+  std::atomic<size_t> tail;         // 消费者读取位置（单调递增）
+  std::atomic<uint32_t> overruns;   // 因缓冲满丢弃的样本数
+
+public:
+  SampleRing() {
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    overruns.store(0, std::memory_order_relaxed);
+  }
+
+  // ========================
+  // 生产者：写入最多 count 个样本，返回实际写入数
+  // ========================
+  size_t write(const T* data, size_t count) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t t = tail.load(std::memory_order_acquire);
+    size_t space = N - (h - t);
+    size_t n = count < space ? count : space;
+
+    size_t first = N - (h & (N - 1));
+    if (first > n) first = n;
+    memcpy(&buffer[h & (N - 1)], data, first * sizeof(T));
+    memcpy(&buffer[0], data + first, (n - first) * sizeof(T));
+
+    head.store(h + n, std::memory_order_release);
+    if (n < count) {
+      overruns.fetch_add(count - n, std::memory_order_relaxed);
+    }
+    return n;
+  }
+
+  // ========================
+  // 消费者：读取最多 count 个样本，返回实际读取数
+  // ========================
+  size_t read(T* out, size_t count) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+    size_t avail = h - t;
+    size_t n = count < avail ? count : avail;
+
+    size_t first = N - (t & (N - 1));
+    if (first > n) first = n;
+    memcpy(out, &buffer[t & (N - 1)], first * sizeof(T));
+    memcpy(out + first, &buffer[0], (n - first) * sizeof(T));
+
+    tail.store(t + n, std::memory_order_release);
+    return n;
+  }
+
+  size_t available() {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+  }
+
+  size_t capacity() {
+    return N;
+  }
+
+  uint32_t overrunCount() {
+    return overruns.load(std::memory_order_relaxed);
+  }
+};
+
+#endif
@@ -0,0 +1,455 @@
+// include/sd_storage.h
+#ifndef SD_STORAGE_H
+#define SD_STORAGE_H
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "psram_policy.h"
+
+#if defined(ESP32) && __has_include(<SD_MMC.h>)
+  #include <SD_MMC.h>
+  #define SD_STORAGE_HAS_SDMMC 1
+#endif
+
+// ========================
+// 存储参数
+// ========================
+#define SD_MOUNT_POINT "/sdcard"
+#define SD_WRITE_CHUNK 16384              // 写缓冲（扇区 512 的整数倍，按该粒度对齐写入）
+#define SD_SEGMENT_MAX_BYTES 4194304UL    // 单个分段文件上限（常见 SD 卡擦除单元 4MB）
+#define SD_FLUSH_INTERVAL_MS 5000         // 空闲流的尾部落盘间隔
+#define SD_RECORD_MAGIC 0x5344
+#define SD_MAX_STREAMS 4
+
+// ========================
+// 记录类型
+// ========================
+enum SdRecordType : uint8_t {
+  SD_RECORD_LOG = 1,              // 文本日志
+  SD_RECORD_TELEMETRY = 2,        // JSON 遥测
+  SD_RECORD_FRAME = 3             // JPEG 帧
+};
+
+// 记录头（12 字节，紧跟负载）
+struct __attribute__((packed)) SdRecordHeader {
+  uint16_t magic;
+  uint8_t type;
+  uint8_t reserved;
+  uint32_t timestamp;             // 秒
+  uint32_t length;
+};
+
+struct SdStorageStats {
+  uint32_t records;
+  uint32_t bytesWritten;
+  uint32_t chunkWrites;           // 对齐的整块写入次数
+  uint32_t tailWrites;            // 空闲时的尾部写入次数
+  uint32_t writeUs;               // 写卡累计耗时
+  uint32_t segments;
+};
+
+typedef std::function<bool(const SdRecordHeader& header, const uint8_t* data)> SdRecordVisitor;
+
+// ========================
+// 记录时间戳：已同步时间时用 Unix 时间，否则用开机秒数
+// ========================
+inline uint32_t storageTimestamp() {
+  time_t now = time(nullptr);
+  return now > 1600000000 ? (uint32_t)now : millis() / 1000;
+}
+
+// ========================
+// 单个数据流（如 frames / logs）
+// 目录 <root>/<name>/，分段文件以首条记录的时间戳命名，便于按时间范围定位
+// ========================
+class SdStream {
+public:
+  String name;
+  String dir;
+  int fd;
+  uint32_t alignedOffset;         // 缓冲起点在文件中的位置（始终是 SD_WRITE_CHUNK 的整数倍）
+  uint32_t used;                  // 缓冲中的字节数
+  bool tailOnDisk;                // 缓冲内容已以尾部形式写入（数据已落盘，但块未写满）
+  uint32_t lastSegment;           // 最新分段的起始时间戳
+  uint32_t lastAppend;
+  std::vector<uint8_t, PolicyAllocator<uint8_t, BUF_LOG> > buffer;   // 默认在内部 DMA 内存，sdmmc 直接整块写卡
+
+  SdStream() : fd(-1), alignedOffset(0), used(0), tailOnDisk(false), lastSegment(0), lastAppend(0) {}
+};
+
+// ========================
+// SD 卡存储层
+// 所有写入先进入 16KB 缓冲，写满后按块对齐一次写入，FAT 可直接整扇区写卡；
+// 空闲时把未满的尾部写出保证掉电不丢，之后从同一对齐位置重写整块，后续写入仍保持对齐。
+// ESP32 上 SD_MMC 挂载到 VFS，主机上用普通目录代替，两边共用 POSIX 文件接口
+// （主机路径需要 Arduino 兼容层，仓库中没有对应的构建环境，未经测试）
+// ========================
+class SdStorage {
+private:
+  String root;
+  SdStream streams[SD_MAX_STREAMS];
+  uint8_t streamCount;
+  SdStorageStats stats;
+  bool ready;
+
+public:
+  SdStorage() {
+    streamCount = 0;
+    ready = false;
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  ~SdStorage() {
+    end();
+  }
+
+  // ========================
+  // 挂载（ESP32：SD_MMC 1-bit 模式，空出 GPIO4 闪光灯 / GPIO12/13）
+  // 主机：rootPath 为任意目录
+  // ========================
+  bool begin(const char* rootPath = SD_MOUNT_POINT) {
+    #ifdef SD_STORAGE_HAS_SDMMC
+      if (!SD_MMC.begin(SD_MOUNT_POINT, true)) {
+        Serial.println("✗ SD card mount failed");
+        return false;
+      }
+      if (SD_MMC.cardType() == CARD_NONE) {
+        Serial.println("✗ No SD card");
+        return false;
+      }
+      Serial.printf("✓ SD card mounted: %u MB\n", (unsigned)(SD_MMC.cardSize() / (1024 * 1024)));
+      root = String(SD_MOUNT_POINT) + "/data";
+      (void)rootPath;
+    #else
+      root = String(rootPath);
+    #endif
+
+    mkdir(root.c_str(), 0755);
+    ready = true;
+    return true;
+  }
+
+  void end() {
+    for (uint8_t i = 0; i < streamCount; i++) {
+      closeSegment(streams[i]);
+    }
+    ready = false;
+  }
+
+  bool isReady() {
+    return ready;
+  }
+
+  // ========================
+  // 追加一条记录
+  // ========================
+  bool append(const char* streamName, SdRecordType type, const uint8_t* data, uint32_t length,
+              uint32_t timestamp = 0) {
+    if (!ready) return false;
+    SdStream* s = openStream(streamName);
+    if (s == nullptr) return false;
+
+    if (timestamp == 0) timestamp = storageTimestamp();
+
+    // 分段满时在记录边界切换
+    if (s->fd >= 0 && s->alignedOffset + s->used + sizeof(SdRecordHeader) + length > SD_SEGMENT_MAX_BYTES) {
+      closeSegment(*s);
+    }
+    if (s->fd < 0 && !openSegment(*s, timestamp)) {
+      return false;
+    }
+
+    SdRecordHeader header = {SD_RECORD_MAGIC, type, 0, timestamp, length};
+    bool ok = bufferWrite(*s, (const uint8_t*)&header, sizeof(header)) && bufferWrite(*s, data, length);
+    s->lastAppend = millis();
+    if (ok) stats.records++;
+    return ok;
+  }
+
+  bool appendLog(const char* streamName, const char* line, uint32_t timestamp = 0) {
+    return append(streamName, SD_RECORD_LOG, (const uint8_t*)line, strlen(line), timestamp);
+  }
+
+  // ========================
+  // 空闲流尾部落盘（在 loop 中调用）
+  // ========================
+  void loop() {
+    for (uint8_t i = 0; i < streamCount; i++) {
+      SdStream& s = streams[i];
+      if (s.used > 0 && !s.tailOnDisk && millis() - s.lastAppend >= SD_FLUSH_INTERVAL_MS) {
+        writeTail(s);
+      }
+    }
+  }
+
+  void flush(const char* streamName) {
+    SdStream* s = findStream(streamName);
+    if (s && s->used > 0 && !s->tailOnDisk) writeTail(*s);
+  }
+
+  // ========================
+  // 按时间范围读取 [from, to]，visitor 返回 false 时停止；返回访问的记录数，
+  // 流名非法或不存在时返回 -1（读取不会创建目录，也不占用流槽位）
+  // skipAtFrom：跳过时间戳等于 from 的前 N 条记录（分页游标，同一秒内可能有多条记录）
+  // 时间未同步时记录使用开机秒数，跨重启的时间范围不可比较
+  // ========================
+  int32_t query(const char* streamName, uint32_t from, uint32_t to, SdRecordVisitor visitor,
+                uint32_t maxRecords = 0xFFFFFFFF, uint32_t skipAtFrom = 0) {
+    String dir;
+    if (!existingStreamDir(streamName, dir)) return -1;
+    flush(streamName);
+
+    std::vector<uint32_t> segments = listSegments(dir);
+    uint32_t visited = 0;
+    uint32_t skipped = 0;
+    std::vector<uint8_t, PolicyAllocator<uint8_t, BUF_FRAME> > payload;
+
+    for (size_t i = 0; i < segments.size() && visited < maxRecords; i++) {
+      // 分段 i 覆盖 [segments[i], segments[i+1])
+      if (segments[i] > to) break;
+      if (i + 1 < segments.size() && segments[i + 1] <= from) continue;
+
+      String path = segmentPath(dir, segments[i]);
+      int fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0) continue;
+      struct stat st;
+      if (fstat(fd, &st) != 0) {
+        close(fd);
+        continue;
+      }
+      uint32_t fileSize = (uint32_t)st.st_size;
+      uint32_t offset = 0;
+
+      SdRecordHeader header;
+      bool more = true;
+      while (more && visited < maxRecords && read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header)) {
+        if (header.magic != SD_RECORD_MAGIC) break;     // 尾部未写完的部分
+        offset += sizeof(header);
+        // 长度超出分段上限或文件剩余字节的记录视为损坏，停止读取该分段
+        if (header.length > SD_SEGMENT_MAX_BYTES || header.length > fileSize - offset) break;
+        bool skip = header.timestamp < from || header.timestamp > to;
+        if (!skip && header.timestamp == from && skipped < skipAtFrom) {
+          skipped++;
+          skip = true;
+        }
+        if (skip) {
+          lseek(fd, header.length, SEEK_CUR);
+          offset += header.length;
+          continue;
+        }
+        // 多留一个结束符，文本记录可直接当作 C 字符串使用
+        payload.resize(header.length + 1);
+        if (read(fd, payload.data(), header.length) != (ssize_t)header.length) break;
+        offset += header.length;
+        payload[header.length] = 0;
+        visited++;
+        more = visitor(header, payload.data());
+      }
+      close(fd);
+      if (!more) break;
+    }
+    return (int32_t)visited;
+  }
+
+  // ========================
+  // 删除最旧的分段，直到该流不超过 keepSegments 个（正在写入的最新分段总是保留）
+  // 流名非法或不存在时返回 false
+  // ========================
+  bool prune(const char* streamName, size_t keepSegments) {
+    String dir;
+    if (!existingStreamDir(streamName, dir)) return false;
+    std::vector<uint32_t> segments = listSegments(dir);
+    for (size_t i = 0; i + keepSegments < segments.size() && i + 1 < segments.size(); i++) {
+      unlink(segmentPath(dir, segments[i]).c_str());
+    }
+    return true;
+  }
+
+  // 流名只能是单级目录名，不能包含 "/" 或 ".."
+  static bool isValidStreamName(const char* name) {
+    return name != nullptr && name[0] != '\0' && strchr(name, '/') == nullptr &&
+           strchr(name, '\\') == nullptr && strstr(name, "..") == nullptr;
+  }
+
+  const SdStorageStats& getStats() {
+    return stats;
+  }
+
+  // 写卡吞吐（KB/s）
+  float getWriteThroughput() {
+    return stats.writeUs > 0 ? stats.bytesWritten * 1000.0f / stats.writeUs : 0;
+  }
+
+private:
+  SdStream* findStream(const char* name) {
+    for (uint8_t i = 0; i < streamCount; i++) {
+      if (streams[i].name == name) return &streams[i];
+    }
+    return nullptr;
+  }
+
+  // 写入时打开（必要时创建）流
+  SdStream* openStream(const char* name) {
+    if (!isValidStreamName(name)) {
+      Serial.printf("✗ Invalid stream name: %s\n", name ? name : "");
+      return nullptr;
+    }
+    SdStream* s = findStream(name);
+    if (s || streamCount >= SD_MAX_STREAMS) return s;
+
+    s = &streams[streamCount++];
+    s->name = String(name);
+    s->dir = root + "/" + name;
+    mkdir(s->dir.c_str(), 0755);
+    std::vector<uint32_t> existing = listSegments(s->dir);
+    s->lastSegment = existing.empty() ? 0 : existing.back();
+    return s;
+  }
+
+  // 读取时只查找：本次运行已打开的流，或卡上已存在的目录（如重启前写入的数据）
+  bool existingStreamDir(const char* name, String& dir) {
+    if (!ready || !isValidStreamName(name)) return false;
+    SdStream* s = findStream(name);
+    if (s) {
+      dir = s->dir;
+      return true;
+    }
+    String path = root + "/" + name;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) return false;
+    dir = path;
+    return true;
+  }
+
+  String segmentPath(const String& dir, uint32_t start) {
+    char name[16];
+    snprintf(name, sizeof(name), "%010u.seg", (unsigned)start);
+    return dir + "/" + name;
+  }
+
+  std::vector<uint32_t> listSegments(const String& dir) {
+    std::vector<uint32_t> segments;
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr) return segments;
+    struct dirent* e;
+    while ((e = readdir(d)) != nullptr) {
+      const char* dot = strstr(e->d_name, ".seg");
+      if (dot && dot[4] == '\0') segments.push_back((uint32_t)strtoul(e->d_name, nullptr, 10));
+    }
+    closedir(d);
+    std::sort(segments.begin(), segments.end());
+    return segments;
+  }
+
+  // 分段名必须递增：同一秒内切换或时间未同步（重启后从 0 计时）时顺延
+  bool openSegment(SdStream& s, uint32_t timestamp) {
+    if (timestamp <= s.lastSegment) timestamp = s.lastSegment + 1;
+    s.lastSegment = timestamp;
+    String path = segmentPath(s.dir, timestamp);
+    s.fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (s.fd < 0) {
+      Serial.println("✗ Failed to open segment: " + path);
+      return false;
+    }
+    if (s.buffer.empty()) s.buffer.resize(SD_WRITE_CHUNK);
+    s.alignedOffset = 0;
+    s.used = 0;
+    s.tailOnDisk = false;
+    stats.segments++;
+    return true;
+  }
+
+  void closeSegment(SdStream& s) {
+    if (s.fd < 0) return;
+    if (s.used > 0 && !s.tailOnDisk) writeTail(s);
+    close(s.fd);
+    s.fd = -1;
+    s.used = 0;
+  }
+
+  bool bufferWrite(SdStream& s, const uint8_t* data, uint32_t length) {
+    while (length > 0) {
+      uint32_t n = SD_WRITE_CHUNK - s.used;
+      if (n > length) n = length;
+      memcpy(s.buffer.data() + s.used, data, n);
+      s.used += n;
+      s.tailOnDisk = false;
+      data += n;
+      length -= n;
+
+      if (s.used == SD_WRITE_CHUNK && !writeChunk(s)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // 整块写入对齐位置，之后缓冲起点前移一块
+  bool writeChunk(SdStream& s) {
+    if (!writeAt(s, SD_WRITE_CHUNK)) return false;
+    s.alignedOffset += SD_WRITE_CHUNK;
+    s.used = 0;
+    stats.chunkWrites++;
+    return true;
+  }
+
+  // 尾部写入：数据落盘，但缓冲起点不变，写满后整块覆盖
+  bool writeTail(SdStream& s) {
+    if (!writeAt(s, s.used)) return false;
+    s.tailOnDisk = true;
+    stats.tailWrites++;
+    return true;
+  }
+
+  bool writeAt(SdStream& s, uint32_t length) {
+    uint32_t start = micros();
+    if (lseek(s.fd, s.alignedOffset, SEEK_SET) != (off_t)s.alignedOffset) {
+      Serial.println("✗ SD seek failed: " + s.name);
+      return false;
+    }
+    ssize_t written = write(s.fd, s.buffer.data(), length);
+    stats.writeUs += micros() - start;
+    if (written != (ssize_t)length) {
+      Serial.println("✗ SD write failed: " + s.name);
+      return false;
+    }
+    stats.bytesWritten += length;
+    return true;
+  }
+};
+
+// ========================
+// 写入吞吐基准
+// 向 streamName 追加 totalBytes 的记录并落盘；返回应用侧吞吐（KB/s，含缓冲和记录头），
+// 写卡本身的吞吐见 getWriteThroughput()。主机上 begin() 指向任意目录即可测量
+// 基准数据留在该流中，可用 prune() 清理
+// ========================
+inline float measureSdWriteThroughput(SdStorage& storage, uint32_t totalBytes = 1048576,
+                                      uint32_t recordBytes = 1024, const char* streamName = "bench") {
+  if (!storage.isReady() || recordBytes == 0) return 0;
+  std::vector<uint8_t> record(recordBytes);
+  for (uint32_t i = 0; i < recordBytes; i++) record[i] = (uint8_t)i;
+
+  uint32_t written = 0;
+  uint32_t start = micros();
+  while (written < totalBytes) {
+    if (!storage.append(streamName, SD_RECORD_TELEMETRY, record.data(), recordBytes)) break;
+    written += recordBytes + sizeof(SdRecordHeader);
+  }
+  storage.flush(streamName);
+  uint32_t elapsed = micros() - start;
+
+  float kbps = elapsed > 0 ? written * 1000.0f / elapsed : 0;
+  Serial.printf("SD write: %u bytes, %.0f KB/s (card %.0f KB/s)\n", (unsigned)written, kbps,
+                storage.getWriteThroughput());
+  return kbps;
+}
+
+#endif
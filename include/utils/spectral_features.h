@@ -0,0 +1,308 @@
+// include/spectral_features.h
+#ifndef SPECTRAL_FEATURES_H
+#define SPECTRAL_FEATURES_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <math.h>
+#include <vector>
+#include "psram_policy.h"
+
+#if defined(ESP32) && __has_include(<esp_dsp.h>)
+  #include <esp_dsp.h>
+  #define SPECTRUM_USE_ESP_DSP 1
+#endif
+
+#define SPECTRUM_MAX_FFT 2048
+#define SPECTRUM_MAX_BANDS 16
+#define SPECTRUM_MAX_PEAKS 4
+
+// ========================
+// 单个窗口的频谱特征
+// ========================
+struct SpectralPeak {
+  float frequencyHz;
+  float amplitude;                // 正弦幅值（采样单位）
+};
+
+struct SpectralFeatures {
+  uint32_t windowIndex;
+  float mean;                     // 直流分量
+  float rms;                      // 去直流后的均方根
+  SpectralPeak peaks[SPECTRUM_MAX_PEAKS];
+  uint8_t peakCount;
+  float bandRms[SPECTRUM_MAX_BANDS];  // 各频带的均方根（平方和约等于 rms²）
+  uint8_t bandCount;
+  uint32_t computeUs;             // 本窗口计算耗时
+};
+
+// ========================
+// 加窗 FFT 特征提取
+// ESP32 上使用 ESP-DSP 的 radix-2 内核，其他平台使用可移植的参考实现
+// ========================
+class SpectralAnalyzer {
+private:
+  size_t fftSize;
+  uint32_t sampleRate;
+  typedef std::vector<float, PolicyAllocator<float, BUF_DSP> > DspBuffer;
+
+  DspBuffer window;               // Hann 窗
+  DspBuffer data;                 // 交错复数 re, im
+  DspBuffer power;                // 单边功率谱
+  DspBuffer twiddle;              // 参考实现的旋转因子 cos, sin
+  float windowSum;
+  float windowSquareSum;
+  float powerScale;               // |X|² -> 均方值
+  float bandEdges[SPECTRUM_MAX_BANDS + 1];
+  uint8_t bandCount;
+  uint8_t peakCount;
+  uint32_t windowIndex;
+
+public:
+  SpectralAnalyzer() {
+    fftSize = 0;
+    sampleRate = 0;
+    windowSum = 0;
+    windowSquareSum = 0;
+    powerScale = 0;
+    bandCount = 0;
+    peakCount = 3;
+    windowIndex = 0;
+  }
+
+  // ========================
+  // 初始化（fftSize 必须是 2 的幂）
+  // 默认把 0 ~ Nyquist 等分为 8 个频带
+  // ========================
+  bool begin(size_t size, uint32_t sampleRateHz) {
+    if (size < 8 || size > SPECTRUM_MAX_FFT || (size & (size - 1)) != 0 || sampleRateHz == 0) {
+      Serial.println("✗ FFT size must be a power of two");
+      return false;
+    }
+
+    #ifdef SPECTRUM_USE_ESP_DSP
+      static bool dspReady = false;
+      if (!dspReady) {
+        if (dsps_fft2r_init_fc32(nullptr, CONFIG_DSP_MAX_FFT_SIZE) != ESP_OK) {
+          Serial.println("✗ ESP-DSP FFT init failed");
+          return false;
+        }
+        dspReady = true;
+      }
+    #endif
+
+    fftSize = size;
+    sampleRate = sampleRateHz;
+    window.assign(size, 0);
+    data.assign(size * 2, 0);
+    power.assign(size / 2, 0);
+
+    #ifdef SPECTRUM_USE_ESP_DSP
+      dsps_wind_hann_f32(window.data(), size);
+    #else
+      for (size_t i = 0; i < size; i++) {
+        window[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / (size - 1));
+      }
+      twiddle.assign(size, 0);
+      for (size_t i = 0; i < size / 2; i++) {
+        twiddle[2 * i] = cosf(2.0f * (float)M_PI * i / size);
+        twiddle[2 * i + 1] = -sinf(2.0f * (float)M_PI * i / size);
+      }
+    #endif
+
+    windowSum = 0;
+    windowSquareSum = 0;
+    for (float w : window) {
+      windowSum += w;
+      windowSquareSum += w * w;
+    }
+
+    float nyquist = sampleRateHz / 2.0f;
+    float edges[9];
+    for (int i = 0; i <= 8; i++) edges[i] = nyquist * i / 8;
+    setBands(edges, 8);
+    windowIndex = 0;
+    return true;
+  }
+
+  // ========================
+  // 设置频带边界（count 个频带需要 count + 1 个边界，单位 Hz）
+  // ========================
+  void setBands(const float* edgesHz, uint8_t count) {
+    if (count > SPECTRUM_MAX_BANDS) count = SPECTRUM_MAX_BANDS;
+    for (uint8_t i = 0; i <= count; i++) bandEdges[i] = edgesHz[i];
+    bandCount = count;
+  }
+
+  void setPeakCount(uint8_t count) {
+    peakCount = count > SPECTRUM_MAX_PEAKS ? SPECTRUM_MAX_PEAKS : count;
+  }
+
+  size_t getFftSize() {
+    return fftSize;
+  }
+
+  float binHz() {
+    return (float)sampleRate / fftSize;
+  }
+
+  // ========================
+  // 处理一个窗口（使用前 fftSize 个样本）
+  // ========================
+  bool process(const int16_t* samples, size_t count, SpectralFeatures& out) {
+    if (fftSize == 0 || count < fftSize) {
+      return false;
+    }
+    uint32_t start = micros();
+
+    // 时域：均值和去直流 RMS
+    float sum = 0;
+    for (size_t i = 0; i < fftSize; i++) sum += samples[i];
+    float mean = sum / fftSize;
+    float sq = 0;
+    for (size_t i = 0; i < fftSize; i++) {
+      float v = samples[i] - mean;
+      sq += v * v;
+      data[2 * i] = v * window[i];
+      data[2 * i + 1] = 0;
+    }
+
+    transform();
+
+    // 单边功率谱，按 Parseval 归一化为均方值
+    powerScale = 2.0f / (fftSize * windowSquareSum);
+    for (size_t k = 0; k < fftSize / 2; k++) {
+      float re = data[2 * k];
+      float im = data[2 * k + 1];
+      power[k] = (re * re + im * im) * (k == 0 ? powerScale / 2 : powerScale);
+    }
+
+    out.windowIndex = windowIndex++;
+    out.mean = mean;
+    out.rms = sqrtf(sq / fftSize);
+    extractBands(out);
+    extractPeaks(out);
+    out.computeUs = micros() - start;
+    return true;
+  }
+
+  // ========================
+  // 紧凑 JSON：{"w":窗口,"rms":..,"dc":..,"pk":[[Hz,幅值],..],"b":[..],"us":..}
+  // ========================
+  // buildPayload 所需的文档容量，extraMembers 为调用方另外添加到根对象的字段数
+  static size_t payloadCapacity(const SpectralFeatures& f, uint8_t extraMembers) {
+    return JSON_OBJECT_SIZE(6 + extraMembers) + JSON_ARRAY_SIZE(f.peakCount) +
+           f.peakCount * JSON_ARRAY_SIZE(2) + JSON_ARRAY_SIZE(f.bandCount);
+  }
+
+  static void buildPayload(JsonDocument& doc, const SpectralFeatures& f) {
+    doc["w"] = f.windowIndex;
+    doc["rms"] = roundTo(f.rms, 100);
+    doc["dc"] = roundTo(f.mean, 10);
+    JsonArray peaks = doc.createNestedArray("pk");
+    for (uint8_t i = 0; i < f.peakCount; i++) {
+      JsonArray p = peaks.createNestedArray();
+      p.add(roundTo(f.peaks[i].frequencyHz, 10));
+      p.add(roundTo(f.peaks[i].amplitude, 10));
+    }
+    JsonArray bands = doc.createNestedArray("b");
+    for (uint8_t i = 0; i < f.bandCount; i++) {
+      bands.add(roundTo(f.bandRms[i], 10));
+    }
+    doc["us"] = f.computeUs;
+  }
+
+private:
+  static float roundTo(float v, float scale) {
+    return roundf(v * scale) / scale;
+  }
+
+  void transform() {
+    #ifdef SPECTRUM_USE_ESP_DSP
+      dsps_fft2r_fc32(data.data(), fftSize);
+      dsps_bit_rev_fc32(data.data(), fftSize);
+    #else
+      referenceFft();
+    #endif
+  }
+
+  // ========================
+  // 可移植的迭代 radix-2 FFT（原地，交错复数）
+  // ========================
+  void referenceFft() {
+    size_t n = fftSize;
+    float* x = data.data();
+
+    for (size_t i = 1, j = 0; i < n; i++) {
+      size_t bit = n >> 1;
+      for (; j & bit; bit >>= 1) j ^= bit;
+      j ^= bit;
+      if (i < j) {
+        float tr = x[2 * i], ti = x[2 * i + 1];
+        x[2 * i] = x[2 * j];
+        x[2 * i + 1] = x[2 * j + 1];
+        x[2 * j] = tr;
+        x[2 * j + 1] = ti;
+      }
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+      size_t half = len / 2;
+      size_t step = n / len;
+      for (size_t i = 0; i < n; i += len) {
+        for (size_t k = 0; k < half; k++) {
+          float wr = twiddle[2 * k * step];
+          float wi = twiddle[2 * k * step + 1];
+          float* a = &x[2 * (i + k)];
+          float* b = &x[2 * (i + k + half)];
+          float br = b[0] * wr - b[1] * wi;
+          float bi = b[0] * wi + b[1] * wr;
+          b[0] = a[0] - br;
+          b[1] = a[1] - bi;
+          a[0] += br;
+          a[1] += bi;
+        }
+      }
+    }
+  }
+
+  void extractBands(SpectralFeatures& out) {
+    float hz = binHz();
+    out.bandCount = bandCount;
+    for (uint8_t b = 0; b < bandCount; b++) {
+      float energy = 0;
+      for (size_t k = 1; k < fftSize / 2; k++) {
+        float f = k * hz;
+        if (f >= bandEdges[b] && f < bandEdges[b + 1]) energy += power[k];
+      }
+      out.bandRms[b] = sqrtf(energy);
+    }
+  }
+
+  // 取局部极大值中最大的几个，用抛物线插值修正频率
+  void extractPeaks(SpectralFeatures& out) {
+    out.peakCount = 0;
+    float hz = binHz();
+    for (size_t k = 2; k + 1 < fftSize / 2; k++) {
+      if (power[k] <= power[k - 1] || power[k] < power[k + 1]) continue;
+
+      // 相干增益修正后的正弦幅值：2|X| / Σw
+      float amplitude = 2.0f * sqrtf(power[k] / powerScale) / windowSum;
+      uint8_t pos = out.peakCount;
+      while (pos > 0 && amplitude > out.peaks[pos - 1].amplitude) pos--;
+      if (pos >= peakCount) continue;
+
+      float a = sqrtf(power[k - 1]), b = sqrtf(power[k]), c = sqrtf(power[k + 1]);
+      float denom = a - 2 * b + c;
+      float offset = denom != 0 ? 0.5f * (a - c) / denom : 0;
+
+      uint8_t last = out.peakCount < peakCount ? out.peakCount : peakCount - 1;
+      for (uint8_t i = last; i > pos; i--) out.peaks[i] = out.peaks[i - 1];
+      out.peaks[pos].frequencyHz = (k + offset) * hz;
+      out.peaks[pos].amplitude = amplitude;
+      if (out.peakCount < peakCount) out.peakCount++;
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,253 @@
+// include/startup_orchestrator.h
+#ifndef STARTUP_ORCHESTRATOR_H
+#define STARTUP_ORCHESTRATOR_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "wifiConfig.h"
+#include "boot_profiler.h"
+
+#ifdef ESP32
+  #include <esp_wifi.h>
+#endif
+
+#ifndef ARDUINO
+  #include <thread>
+#endif
+
+#define STARTUP_WIFI_TIMEOUT_MS 10000     // 缓存凭据关联超时，超时后进入配置门户
+
+typedef std::function<void()> StartupStep;
+
+// ========================
+// 并行启动
+// 上电后立即用缓存的凭据开始 Wi-Fi 关联（关联在 Wi-Fi 驱动任务中进行），
+// 同时在独立任务中挂载文件系统、读取配置、初始化传感器；
+// 只有在需要网络时才等待两者完成，缩短上电到第一条消息的时间
+//
+//   StartupOrchestrator startup("ESP-Device");
+//   startup.addInitStep("sensor.init", []() { sensor.begin(); });
+//   startup.begin();
+//   ...                                // 与网络无关的初始化
+//   if (startup.waitForNetwork()) mqttManager.connect();
+//
+// 配置参数需在 begin() 之前注册；初始化任务读取配置期间，其他任务的 getConfigValue 等
+// 配置访问会等待读取完成（见 wifiConfig.h 的 CONFIG_LOCK），不要直接访问 configParams / configValues
+// ========================
+class StartupOrchestrator {
+private:
+  struct Step {
+    const char* name;
+    StartupStep fn;
+  };
+
+  const char* deviceName;
+  std::vector<Step> steps;
+  std::atomic<bool> initDone;
+  bool initJoined;
+  bool fsOk;
+  bool configOk;
+  bool cachedCredentials;
+  bool networkReady;
+  bool usedPortal;
+  uint32_t wifiStartUs;
+  std::atomic<uint32_t> gotIpUs;      // 取得 IP 的时间（Wi-Fi 事件任务写入，0 表示尚未取得）
+  uint32_t wifiTimeoutMs;
+  #ifdef ESP32
+    wifi_event_id_t gotIpEvent;
+    bool gotIpHandler;
+  #endif
+  #ifndef ARDUINO
+    std::thread worker;
+  #endif
+
+public:
+  StartupOrchestrator(const char* name = "ESP-Device") {
+    deviceName = name;
+    initDone = true;
+    initJoined = true;
+    fsOk = false;
+    configOk = false;
+    cachedCredentials = false;
+    networkReady = false;
+    usedPortal = false;
+    wifiStartUs = 0;
+    gotIpUs = 0;
+    wifiTimeoutMs = STARTUP_WIFI_TIMEOUT_MS;
+    #ifdef ESP32
+      gotIpHandler = false;
+    #endif
+  }
+
+  ~StartupOrchestrator() {
+    removeGotIpHandler();
+    waitForInit();
+  }
+
+  // 在初始化任务中按注册顺序执行（如传感器初始化），需在 begin() 之前注册
+  void addInitStep(const char* name, StartupStep fn) {
+    Step step;
+    step.name = name;
+    step.fn = fn;
+    steps.push_back(step);
+  }
+
+  void setWiFiTimeout(uint32_t timeoutMs) {
+    wifiTimeoutMs = timeoutMs;
+  }
+
+  // ========================
+  // 开始 Wi-Fi 关联并启动初始化任务
+  // ========================
+  bool begin() {
+    if (!initJoined) return true;
+
+    // 先启动 Wi-Fi：关联耗时最长，越早开始越好
+    WiFi.mode(WIFI_STA);
+    cachedCredentials = hasCachedCredentials();
+    if (cachedCredentials) {
+      // 关联结束时间取自 GOT_IP 事件，而不是主任务轮询到连接的时间
+      gotIpUs = 0;
+      #ifdef ESP32
+        gotIpEvent = WiFi.onEvent([this](WiFiEvent_t, WiFiEventInfo_t) {
+          uint32_t none = 0;
+          gotIpUs.compare_exchange_strong(none, micros());
+        }, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+        gotIpHandler = true;
+      #endif
+      wifiStartUs = micros();
+      WiFi.begin();
+      DEBUG_PRINTLN("✓ WiFi association started with cached credentials");
+    } else {
+      DEBUG_PRINTLN("⚠ No cached WiFi credentials, portal required");
+    }
+
+    initDone = false;
+    initJoined = false;
+    configLoading = true;
+    #ifdef ARDUINO
+      if (xTaskCreatePinnedToCore(initTask, "startup_init", 8192, this, 1, nullptr, tskNO_AFFINITY) != pdPASS) {
+        DEBUG_PRINTLN("✗ Startup task create failed, running inline");
+        runInit();
+        initDone = true;
+      }
+    #else
+      worker = std::thread(initTask, this);
+    #endif
+    return true;
+  }
+
+  // ========================
+  // 等待初始化任务完成（此后可以安全访问配置）
+  // ========================
+  void waitForInit() {
+    if (initJoined) return;
+    #ifdef ARDUINO
+      while (!initDone) delay(1);
+    #else
+      if (worker.joinable()) worker.join();
+    #endif
+    initJoined = true;
+  }
+
+  // ========================
+  // 等待网络就绪：先汇合初始化任务，再等待关联完成；
+  // 没有缓存凭据或关联超时时进入 WiFiManager 配置门户
+  // ========================
+  bool waitForNetwork() {
+    if (networkReady) return true;
+    waitForInit();
+
+    if (cachedCredentials) {
+      BOOT_PHASE("wifi.wait");
+      while (WiFi.status() != WL_CONNECTED && micros() - wifiStartUs < wifiTimeoutMs * 1000UL) {
+        delay(10);
+      }
+    }
+    removeGotIpHandler();
+
+    if (WiFi.status() == WL_CONNECTED) {
+      // 没有收到事件（非 ESP32）时以检测到连接的时间为准
+      uint32_t assocEndUs = gotIpUs;
+      if (assocEndUs == 0) assocEndUs = micros();
+      bootProfiler.record("wifi.assoc", wifiStartUs, assocEndUs - wifiStartUs);
+      Serial.printf("✓ WiFi connected: %s (%s)\n", WiFi.SSID().c_str(), WiFi.localIP().toString().c_str());
+      networkReady = true;
+      return true;
+    }
+
+    DEBUG_PRINTLN("⚠ Cached credentials failed, starting config portal...");
+    usedPortal = true;
+    networkReady = runWiFiManager(deviceName, AUTO_START_AP);
+    return networkReady;
+  }
+
+  bool isInitDone() {
+    return initDone;
+  }
+
+  bool isNetworkReady() {
+    return networkReady;
+  }
+
+  bool isFileSystemMounted() {
+    return fsOk;
+  }
+
+  bool isConfigLoaded() {
+    return configOk;
+  }
+
+  bool usedConfigPortal() {
+    return usedPortal;
+  }
+
+private:
+  static void initTask(void* arg) {
+    StartupOrchestrator* self = static_cast<StartupOrchestrator*>(arg);
+    self->runInit();
+    self->initDone = true;
+    #ifdef ARDUINO
+      vTaskDelete(nullptr);
+    #endif
+  }
+
+  void runInit() {
+    BOOT_PHASE("startup.init");
+    initChipInfo();
+    fsOk = initFileSystem();
+    configOk = fsOk && readConfig();
+    configLoading = false;
+    if (!configOk) {
+      DEBUG_PRINTLN("Using default config values");
+    }
+
+    for (auto& step : steps) {
+      int phase = bootProfiler.begin(step.name);
+      step.fn();
+      bootProfiler.end(phase);
+    }
+  }
+
+  void removeGotIpHandler() {
+    #ifdef ESP32
+      if (!gotIpHandler) return;
+      WiFi.removeEvent(gotIpEvent);
+      gotIpHandler = false;
+    #endif
+  }
+
+  static bool hasCachedCredentials() {
+    #ifdef ESP32
+      wifi_config_t conf;
+      if (esp_wifi_get_config(WIFI_IF_STA, &conf) != ESP_OK) return false;
+      return conf.sta.ssid[0] != 0;
+    #else
+      return WiFi.SSID().length() > 0;
+    #endif
+  }
+};
+
+#endif
@@ -0,0 +1,64 @@
+// include/status_profile.h
+#ifndef STATUS_PROFILE_H
+#define STATUS_PROFILE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "tx_scheduler.h"
+
+// ========================
+// 状态字段
+// ========================
+#define STATUS_FIELD_UPTIME     0x0001
+#define STATUS_FIELD_RSSI       0x0002
+#define STATUS_FIELD_HEAP       0x0004
+#define STATUS_FIELD_IP         0x0008
+#define STATUS_FIELD_CHIP       0x0010
+#define STATUS_FIELD_DEVICE_ID  0x0020
+#define STATUS_FIELD_CONNECTED  0x0040
+#define STATUS_FIELD_TIMESTAMP  0x0080
+#define STATUS_FIELD_ALL        0x00FF
+
+// ========================
+// 状态上报档位
+// ========================
+enum StatusProfileId : uint8_t {
+  STATUS_HEARTBEAT = 0,           // 轻量心跳：字段少、周期短，用于存活检测
+  STATUS_FULL,                    // 完整状态：字段全、周期长，也可按需请求
+  STATUS_PROFILE_COUNT
+};
+
+struct StatusProfile {
+  const char* subTopic;           // 发布子主题
+  uint32_t intervalMs;            // 自动发布间隔（0 表示只按需发布）
+  uint16_t fields;                // STATUS_FIELD_* 组合
+  bool compactKeys;               // 使用单字母键名以减少字节数
+  MessagePriority priority;
+  uint32_t lastPublish;
+};
+
+// ========================
+// 状态快照（发布时采集一次，按档位取字段）
+// ========================
+struct StatusSnapshot {
+  const char* deviceId;
+  const char* chipType;
+  const char* ipAddress;
+  bool isConnected;
+  uint32_t uptime;
+  int signalStrength;
+  uint32_t freeHeap;
+};
+
+inline void buildStatusPayload(JsonDocument& doc, const StatusSnapshot& s, uint16_t fields, bool compact) {
+  if (fields & STATUS_FIELD_DEVICE_ID) doc[compact ? "d" : "device_id"] = s.deviceId;
+  if (fields & STATUS_FIELD_CHIP)      doc[compact ? "c" : "chip_type"] = s.chipType;
+  if (fields & STATUS_FIELD_CONNECTED) doc[compact ? "n" : "is_connected"] = s.isConnected;
+  if (fields & STATUS_FIELD_UPTIME)    doc[compact ? "u" : "uptime"] = s.uptime;
+  if (fields & STATUS_FIELD_RSSI)      doc[compact ? "r" : "signal_strength"] = s.signalStrength;
+  if (fields & STATUS_FIELD_HEAP)      doc[compact ? "h" : "free_heap"] = s.freeHeap;
+  if (fields & STATUS_FIELD_IP)        doc[compact ? "i" : "ip_address"] = s.ipAddress;
+  if (fields & STATUS_FIELD_TIMESTAMP) doc[compact ? "t" : "timestamp"] = millis();
+}
+
+#endif
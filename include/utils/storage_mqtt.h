@@ -0,0 +1,128 @@
+// include/storage_mqtt.h
+#ifndef STORAGE_MQTT_H
+#define STORAGE_MQTT_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include "sd_storage.h"
+#include "psram_policy.h"
+#include "mqtt_manager.h"
+
+#define STORAGE_MQTT_MAX_REQUESTS 4
+#define STORAGE_MQTT_DEFAULT_RECORDS 20
+#define STORAGE_MQTT_MAX_RECORDS 100
+
+// ========================
+// 通过 MQTT 按时间范围取回存储记录
+// 请求：<prefix>/<id>/storage/get  {"stream":"logs","from":t0,"to":t1,"max":20,"skip":0}
+// 日志 / 遥测：storage/data/<stream>       {"t":时间戳,"d":"内容"}
+// 帧：        storage/data/<stream>       JPEG 二进制，随后 .../meta {"t":..,"bytes":..}
+// 结束：      storage/done                {"stream":..,"count":..,"more":bool,"next":t,"skip":n}
+// 错误：      storage/done                {"stream":..,"error":"unknown stream"}
+// 下一页用 from=next、skip=n 请求（同一秒内可能有多条记录，skip 跳过 next 这一秒已发送的条数）
+// ========================
+class StorageMqttBridge {
+private:
+  struct Request {
+    String stream;
+    uint32_t from;
+    uint32_t to;
+    uint32_t max;
+    uint32_t skip;                // 跳过时间戳等于 from 的前 skip 条
+  };
+
+  SdStorage& storage;
+  MQTTManager& manager;
+  String requestTopic;
+  std::vector<Request> requests;
+
+public:
+  StorageMqttBridge(SdStorage& sdStorage, MQTTManager& mqttManager) : storage(sdStorage), manager(mqttManager) {}
+
+  void begin() {
+    requestTopic = manager.getFullTopic("storage/get");
+    manager.registerTopic("storage/get");
+    manager.addMessageObserver([this](const char* topic, JsonDocument& doc) {
+      if (requestTopic == topic) this->onRequest(doc);
+    });
+  }
+
+  // ========================
+  // 在 loop 中调用：每次处理一个请求
+  // ========================
+  void loop() {
+    if (requests.empty() || !manager.isConnected()) return;
+
+    Request r = requests.front();
+    requests.erase(requests.begin());
+
+    // 游标：最后一条成功发送的记录的时间戳，以及该秒内已发送的条数
+    uint32_t sent = 0;
+    uint32_t last = r.from;
+    uint32_t sameSecond = r.skip;
+    bool publishFailed = false;
+    int32_t visited = storage.query(r.stream.c_str(), r.from, r.to,
+      [&](const SdRecordHeader& header, const uint8_t* data) {
+        if (!this->publishRecord(r.stream, header, data)) {
+          publishFailed = true;
+          return false;
+        }
+        sameSecond = header.timestamp == last ? sameSecond + 1 : 1;
+        last = header.timestamp;
+        sent++;
+        return true;
+      }, r.max, r.skip);
+
+    PolicyJsonDocument done(192);
+    done["stream"] = r.stream;
+    if (visited < 0) {
+      done["error"] = "unknown stream";
+      manager.publishJson("storage/done", done, PRIORITY_URGENT);
+      return;
+    }
+
+    // 达到条数上限或发送失败提前停止时给出下一页的游标
+    bool more = publishFailed || sent >= r.max;
+    done["count"] = sent;
+    done["more"] = more;
+    if (more) {
+      done["next"] = last;
+      done["skip"] = sameSecond;
+    }
+    manager.publishJson("storage/done", done, PRIORITY_URGENT);
+  }
+
+private:
+  void onRequest(JsonDocument& doc) {
+    if (requests.size() >= STORAGE_MQTT_MAX_REQUESTS) return;
+    Request r;
+    r.stream = String(doc["stream"] | "logs");
+    r.from = doc["from"] | 0;
+    r.to = doc["to"] | 0xFFFFFFFF;
+    r.max = doc["max"] | STORAGE_MQTT_DEFAULT_RECORDS;
+    if (r.max == 0 || r.max > STORAGE_MQTT_MAX_RECORDS) r.max = STORAGE_MQTT_MAX_RECORDS;
+    r.skip = doc["skip"] | 0;
+    requests.push_back(r);
+  }
+
+  bool publishRecord(const String& stream, const SdRecordHeader& header, const uint8_t* data) {
+    String topic = "storage/data/" + stream;
+
+    if (header.type == SD_RECORD_FRAME) {
+      if (!manager.publishBinary(topic.c_str(), data, header.length)) return false;
+      PolicyJsonDocument meta(96);
+      meta["t"] = header.timestamp;
+      meta["bytes"] = header.length;
+      String metaTopic = topic + "/meta";
+      return manager.publishJson(metaTopic.c_str(), meta, PRIORITY_URGENT);
+    }
+
+    PolicyJsonDocument doc(header.length + 128);
+    doc["t"] = header.timestamp;
+    doc["d"] = (const char*)data;
+    return manager.publishJson(topic.c_str(), doc, PRIORITY_URGENT);
+  }
+};
+
+#endif
@@ -0,0 +1,150 @@
+// include/string_intern.h
+#ifndef STRING_INTERN_H
+#define STRING_INTERN_H
+
+#include <Arduino.h>
+#include <string.h>
+#include <mutex>
+#include <vector>
+
+// ========================
+// 全局字符串驻留表
+// 每个不同的主题名 / 配置键只保存一份，之后按指针比较；
+// 驻留的字符串永不释放，所以只驻留注册过的主题和配置键（数量有限），
+// 不要驻留运行时产生的任意字符串；可在多个任务中并发使用
+// ========================
+struct InternEntry {
+  uint32_t hash;
+  const char* str;
+};
+
+class StringInternTable {
+private:
+  std::vector<InternEntry> slots;   // 开放寻址哈希表，容量为 2 的幂
+  size_t count;
+  std::mutex lock;                  // 扩容会重新分配 slots，查找也要加锁
+
+public:
+  StringInternTable() {
+    slots.assign(32, InternEntry{0, nullptr});
+    count = 0;
+  }
+
+  // ========================
+  // FNV-1a 哈希
+  // ========================
+  static uint32_t hashOf(const char* str, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+      h ^= (uint8_t)str[i];
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  // ========================
+  // 只查找，不插入（未驻留返回 nullptr）
+  // ========================
+  const char* find(const char* str, size_t len) {
+    std::lock_guard<std::mutex> guard(lock);
+    return findLocked(str, len);
+  }
+
+  // ========================
+  // 查找或插入
+  // ========================
+  const char* intern(const char* str) {
+    size_t len = strlen(str);
+    std::lock_guard<std::mutex> guard(lock);
+    const char* existing = findLocked(str, len);
+    if (existing) return existing;
+
+    if ((count + 1) * 4 > slots.size() * 3) {
+      grow();
+    }
+
+    char* copy = (char*)malloc(len + 1);
+    memcpy(copy, str, len + 1);
+    insert(InternEntry{hashOf(str, len), copy});
+    count++;
+    return copy;
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> guard(lock);
+    return count;
+  }
+
+private:
+  const char* findLocked(const char* str, size_t len) {
+    uint32_t h = hashOf(str, len);
+    size_t mask = slots.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+      const InternEntry& e = slots[i];
+      if (e.str == nullptr) return nullptr;
+      if (e.hash == h && strncmp(e.str, str, len) == 0 && e.str[len] == '\0') return e.str;
+    }
+  }
+
+  void insert(const InternEntry& entry) {
+    size_t mask = slots.size() - 1;
+    size_t i = entry.hash & mask;
+    while (slots[i].str != nullptr) i = (i + 1) & mask;
+    slots[i] = entry;
+  }
+
+  void grow() {
+    std::vector<InternEntry> old;
+    old.swap(slots);
+    slots.assign(old.size() * 2, InternEntry{0, nullptr});
+    for (auto& e : old) {
+      if (e.str) insert(e);
+    }
+  }
+};
+
+// 函数内静态对象，保证在全局对象构造前可用
+inline StringInternTable& internTable() {
+  static StringInternTable table;
+  return table;
+}
+
+inline const char* internString(const char* str) {
+  return internTable().intern(str);
+}
+
+inline const char* internFind(const char* str) {
+  return internTable().find(str, strlen(str));
+}
+
+// ========================
+// 驻留字符串句柄（与另一个句柄比较只比较指针）
+// ========================
+class InternedString {
+private:
+  const char* ptr;
+
+public:
+  InternedString() : ptr(internString("")) {}
+  InternedString(const char* str) : ptr(internString(str)) {}
+  InternedString(const String& str) : ptr(internString(str.c_str())) {}
+
+  // 只查找不插入：未驻留的字符串不可能等于任何已注册的主题 / 键
+  static bool lookup(const char* str, InternedString& out) {
+    const char* found = internFind(str);
+    if (found == nullptr) return false;
+    out.ptr = found;
+    return true;
+  }
+
+  const char* c_str() const { return ptr; }
+  size_t length() const { return strlen(ptr); }
+
+  bool operator==(const InternedString& other) const { return ptr == other.ptr; }
+  bool operator!=(const InternedString& other) const { return ptr != other.ptr; }
+  bool operator==(const char* other) const { return strcmp(ptr, other) == 0; }
+  bool operator!=(const char* other) const { return strcmp(ptr, other) != 0; }
+  bool operator<(const InternedString& other) const { return ptr < other.ptr; }
+};
+
+#endif
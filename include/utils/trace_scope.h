@@ -0,0 +1,137 @@
+// include/trace_scope.h
+#ifndef TRACE_SCOPE_H
+#define TRACE_SCOPE_H
+
+// ========================
+// 执行追踪（Chrome trace / Perfetto 格式）
+// 主机构建默认开启，设备端编译为空操作
+// 注意：platformio.ini 只有 esp32cam 环境，没有 native 环境和 Arduino 兼容层，
+// 本文件及其他 #ifndef ARDUINO 的主机路径（net_interface / mqtt_backend 回环 / sd_storage /
+// http_uploader 的主机分支）在本仓库中不会被编译，也没有经过测试
+// ========================
+#ifndef TRACE_ENABLED
+  #ifdef ARDUINO
+    #define TRACE_ENABLED 0
+  #else
+    #define TRACE_ENABLED 1
+  #endif
+#endif
+
+#ifndef TRACE_MAX_EVENTS
+  #define TRACE_MAX_EVENTS 65536          // 环形缓冲容量，满后覆盖最旧的事件
+#endif
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#if TRACE_ENABLED
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ========================
+// 追踪事件结构体（名称和分类必须是字符串常量）
+// ========================
+struct TraceEvent {
+  const char* name;
+  const char* category;
+  uint64_t startUs;
+  uint64_t durationUs;
+  uint32_t threadId;
+};
+
+// 环形缓冲：未满时顺序追加，满后 traceHead 指向最旧的事件
+std::vector<TraceEvent> traceEvents;
+size_t traceHead = 0;
+uint64_t traceOverwritten = 0;
+std::mutex traceMutex;
+
+inline void tracePush(const TraceEvent& event) {
+  std::lock_guard<std::mutex> lock(traceMutex);
+  if (traceEvents.size() < TRACE_MAX_EVENTS) {
+    traceEvents.push_back(event);
+    return;
+  }
+  traceEvents[traceHead] = event;
+  traceHead = (traceHead + 1) % TRACE_MAX_EVENTS;
+  traceOverwritten++;
+}
+
+inline uint64_t traceNowUs() {
+  static const auto origin = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - origin).count();
+}
+
+// ========================
+// 作用域追踪（析构时记录一个完整事件）
+// ========================
+class TraceScope {
+private:
+  const char* name;
+  const char* category;
+  uint64_t start;
+
+public:
+  TraceScope(const char* name, const char* category) : name(name), category(category) {
+    start = traceNowUs();
+  }
+
+  ~TraceScope() {
+    uint64_t end = traceNowUs();
+    uint32_t tid = (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+    tracePush({name, category, start, end - start, tid});
+  }
+};
+
+// ========================
+// 清空已记录的事件
+// ========================
+inline void traceClear() {
+  std::lock_guard<std::mutex> lock(traceMutex);
+  traceEvents.clear();
+  traceHead = 0;
+  traceOverwritten = 0;
+}
+
+// ========================
+// 导出为 Chrome trace JSON（chrome://tracing 或 ui.perfetto.dev 打开）
+// ========================
+inline bool traceExport(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(traceMutex);
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  // 从最旧的事件开始按时间顺序输出
+  for (size_t i = 0; i < traceEvents.size(); i++) {
+    const TraceEvent& e = traceEvents[(traceHead + i) % traceEvents.size()];
+    fprintf(file,
+            "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":%u}%s\n",
+            e.name, e.category,
+            (unsigned long long)e.startUs, (unsigned long long)e.durationUs,
+            (unsigned)e.threadId,
+            i + 1 < traceEvents.size() ? "," : "");
+  }
+  fprintf(file, "]}\n");
+  fclose(file);
+  return true;
+}
+
+#define TRACE_SCOPE(name, category) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name, category)
+#define TRACE_EXPORT(path) traceExport(path)
+
+#else
+
+#define TRACE_SCOPE(name, category)
+#define TRACE_EXPORT(path) false
+
+#endif
+
+#endif
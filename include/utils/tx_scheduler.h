@@ -0,0 +1,191 @@
+// include/tx_scheduler.h
+#ifndef TX_SCHEDULER_H
+#define TX_SCHEDULER_H
+
+#include <Arduino.h>
+#include <algorithm>
+#include <vector>
+#include "psram_policy.h"
+
+#ifdef ESP32
+  #include <WiFi.h>
+#elif defined(ESP8266)
+  #include <ESP8266WiFi.h>
+#endif
+
+// ========================
+// 消息优先级
+// ========================
+enum MessagePriority : uint8_t {
+  PRIORITY_URGENT = 0,            // 控制 / 告警，立即发送
+  PRIORITY_NORMAL = 1,            // 普通遥测
+  PRIORITY_BULK = 2               // 可延迟的批量数据
+};
+
+#define TX_PRIORITY_LEVELS 3
+#define TX_SCHEDULER_MAX_QUEUE 32   // 队列满时立即开窗发送
+
+// ========================
+// 待发送消息
+// ========================
+struct ScheduledMessage {
+  String topic;
+  String payload;
+  MessagePriority priority;
+  uint8_t tag;                    // 调用方自定义标记（如能耗子系统）
+  uint32_t deadline;              // 最迟发送时间（millis）
+};
+
+typedef std::vector<ScheduledMessage, PolicyAllocator<ScheduledMessage, BUF_PUBLISH_QUEUE> > ScheduledQueue;
+
+// ========================
+// 发送窗口调度器
+// 非紧急消息缓存到对齐的发送窗口中集中发送，窗口之间射频进入 modem sleep；
+// 任一消息到达延迟预算时提前开窗并顺带发送其余消息
+// ========================
+class TxScheduler {
+private:
+  ScheduledQueue queue;
+  uint32_t periodMs;                          // 窗口周期
+  uint32_t latencyBudgetMs[TX_PRIORITY_LEVELS];
+  uint32_t nextWindow;                        // 下一个对齐窗口
+  bool modemSleep;                            // 窗口之间是否启用 modem sleep
+  bool wifiLink;                              // 当前链路是 Wi-Fi（以太网时不碰 Wi-Fi 省电状态）
+  bool enabled;
+
+public:
+  TxScheduler() {
+    periodMs = 10000;
+    latencyBudgetMs[PRIORITY_URGENT] = 0;
+    latencyBudgetMs[PRIORITY_NORMAL] = 30000;
+    latencyBudgetMs[PRIORITY_BULK] = 300000;
+    nextWindow = 0;
+    modemSleep = true;
+    wifiLink = true;
+    enabled = false;
+  }
+
+  // ========================
+  // 配置
+  // ========================
+  void begin(uint32_t windowPeriodMs, bool useModemSleep = true) {
+    periodMs = windowPeriodMs > 0 ? windowPeriodMs : 1;
+    modemSleep = useModemSleep;
+    enabled = true;
+    nextWindow = alignedWindowAfter(millis());
+    enterSleep();
+  }
+
+  void end() {
+    enabled = false;
+    exitSleep();
+  }
+
+  // 当前链路是否为 Wi-Fi；窗口启用期间切换时先恢复 / 再进入 modem sleep
+  void setWiFiLink(bool isWiFi) {
+    if (isWiFi == wifiLink) return;
+    if (enabled && !isWiFi) exitSleep();
+    wifiLink = isWiFi;
+    if (enabled && isWiFi) enterSleep();
+  }
+
+  void setLatencyBudget(MessagePriority priority, uint32_t budgetMs) {
+    latencyBudgetMs[priority] = budgetMs;
+  }
+
+  bool isEnabled() {
+    return enabled;
+  }
+
+  size_t pending() {
+    return queue.size();
+  }
+
+  // ========================
+  // 缓存消息；紧急消息或未启用时返回 false（调用方应立即发送）
+  // ========================
+  bool enqueue(const char* topic, const char* payload, MessagePriority priority, uint8_t tag = 0) {
+    if (!enabled || priority == PRIORITY_URGENT || latencyBudgetMs[priority] == 0) {
+      return false;
+    }
+
+    ScheduledMessage msg;
+    msg.topic = String(topic);
+    msg.payload = String(payload);
+    msg.priority = priority;
+    msg.tag = tag;
+    msg.deadline = millis() + latencyBudgetMs[priority];
+    queue.push_back(msg);
+    return true;
+  }
+
+  // ========================
+  // 是否应开窗发送
+  // ========================
+  bool windowDue() {
+    if (!enabled || queue.empty()) {
+      return false;
+    }
+
+    uint32_t now = millis();
+    if ((int32_t)(now - nextWindow) >= 0 || queue.size() >= TX_SCHEDULER_MAX_QUEUE) {
+      return true;
+    }
+    for (auto& msg : queue) {
+      if ((int32_t)(now - msg.deadline) >= 0) return true;
+    }
+    return false;
+  }
+
+  // ========================
+  // 开窗：唤醒射频，取出全部待发送消息（按优先级排序）
+  // ========================
+  ScheduledQueue openWindow() {
+    exitSleep();
+
+    ScheduledQueue batch;
+    batch.swap(queue);
+    std::stable_sort(batch.begin(), batch.end(), [](const ScheduledMessage& a, const ScheduledMessage& b) {
+      return a.priority < b.priority;
+    });
+    return batch;
+  }
+
+  // ========================
+  // 关窗：射频回到 modem sleep，计算下一个对齐窗口
+  // ========================
+  void closeWindow() {
+    nextWindow = alignedWindowAfter(millis());
+    enterSleep();
+  }
+
+private:
+  uint32_t alignedWindowAfter(uint32_t now) {
+    return (now / periodMs + 1) * periodMs;
+  }
+
+  void enterSleep() {
+    if (!modemSleep || !wifiLink) return;
+    #ifdef ESP32
+      WiFi.setSleep(WIFI_PS_MAX_MODEM);
+    #elif defined(ESP8266)
+      WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+    #endif
+  }
+
+  void exitSleep() {
+    if (!modemSleep || !wifiLink) return;
+    #ifdef ESP32
+      #ifdef CONFIG_BT_ENABLED
+        // 蓝牙共存时 Wi-Fi 必须保持 modem sleep，设置 WIFI_PS_NONE 会触发断言
+        WiFi.setSleep(btStarted() ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
+      #else
+        WiFi.setSleep(WIFI_PS_NONE);
+      #endif
+    #elif defined(ESP8266)
+      WiFi.setSleepMode(WIFI_NONE_SLEEP);
+    #endif
+  }
+};
+
+#endif
@@ -0,0 +1,71 @@
+// include/upload_notifier.h
+#ifndef UPLOAD_NOTIFIER_H
+#define UPLOAD_NOTIFIER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "http_uploader.h"
+#include "mqtt_manager.h"
+
+// ========================
+// 上传完成通知
+// 大块数据走 HTTP，MQTT 只发送控制和通知：
+// <prefix>/<id>/upload/done  {"id":..,"path":..,"status":200,"ok":true,"bytes":..,"ms":..,"queued_ms":..,"kbps":..}
+// 端点来自配置项 upload_url（需在 initWiFiManager 之前 registerParam）
+// ========================
+class MQTTUploadNotifier {
+private:
+  HttpUploader& uploader;
+  MQTTManager& manager;
+  uint32_t succeeded;
+  uint32_t failed;
+
+public:
+  MQTTUploadNotifier(HttpUploader& httpUploader, MQTTManager& mqttManager)
+    : uploader(httpUploader), manager(mqttManager) {
+    succeeded = 0;
+    failed = 0;
+  }
+
+  bool begin() {
+    String url = getConfigValue("upload_url");
+    if (url.length() == 0 || !uploader.setEndpoint(url.c_str())) {
+      Serial.println("✗ Upload endpoint not configured");
+      return false;
+    }
+    uploader.setResultHandler([this](const UploadResult& r) {
+      this->onResult(r);
+    });
+    Serial.println("✓ Upload endpoint: " + url);
+    return uploader.start();
+  }
+
+  // ========================
+  // 在 loop 中调用
+  // ========================
+  void loop() {
+    uploader.poll();
+  }
+
+  uint32_t getSucceeded() { return succeeded; }
+  uint32_t getFailed() { return failed; }
+
+private:
+  void onResult(const UploadResult& r) {
+    bool ok = r.status >= 200 && r.status < 300;
+    if (ok) succeeded++; else failed++;
+
+    PolicyJsonDocument doc(256);
+    doc["id"] = r.id;
+    doc["path"] = r.path;
+    doc["status"] = r.status;
+    doc["ok"] = ok;
+    doc["bytes"] = r.bytes;
+    doc["ms"] = r.durationMs;
+    doc["queued_ms"] = r.queuedMs;
+    doc["kbps"] = r.durationMs > 0 ? r.bytes * 8 / r.durationMs : 0;
+    manager.publishJson("upload/done", doc, ok ? PRIORITY_NORMAL : PRIORITY_URGENT);
+  }
+};
+
+#endif
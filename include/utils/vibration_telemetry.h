@@ -0,0 +1,199 @@
+// include/vibration_telemetry.h
+#ifndef VIBRATION_TELEMETRY_H
+#define VIBRATION_TELEMETRY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+#include "adc_capture.h"
+#include "spectral_features.h"
+#include "anomaly_detector.h"
+#include "mqtt_manager.h"
+
+typedef std::function<void(const SpectralFeatures& features)> FeatureHandler;
+
+// ========================
+// 振动遥测：采样 -> 加窗 FFT -> 特征聚合 -> MQTT
+// 每个窗口都提取特征，上报周期内按能量平均后只发布一条紧凑消息
+// ========================
+class VibrationTelemetry {
+private:
+  AdcCapture& capture;
+  SpectralAnalyzer& analyzer;
+  MQTTManager& manager;
+  String subTopic;
+  uint32_t reportIntervalMs;
+  uint32_t lastReport;
+  FeatureHandler featureHandler;
+  AnomalyDetector* detector;      // 可选：只在行为偏离时上报
+  bool reportOnlyOnAnomaly;
+  AnomalyResult lastAnomaly;
+
+  // 当前上报周期的聚合
+  SpectralFeatures latest;
+  uint32_t windows;
+  float meanSquareSum;
+  float peakRms;
+  float bandSquareSum[SPECTRUM_MAX_BANDS];
+
+  // 上行数据量统计
+  uint32_t rawBytes;
+  uint32_t publishedBytes;
+
+public:
+  VibrationTelemetry(AdcCapture& adcCapture, SpectralAnalyzer& spectralAnalyzer, MQTTManager& mqttManager)
+    : capture(adcCapture), analyzer(spectralAnalyzer), manager(mqttManager) {
+    reportIntervalMs = 10000;
+    lastReport = 0;
+    rawBytes = 0;
+    publishedBytes = 0;
+    detector = nullptr;
+    reportOnlyOnAnomaly = false;
+    memset(&lastAnomaly, 0, sizeof(lastAnomaly));
+    resetAggregate();
+  }
+
+  // ========================
+  // 开始处理（采集和分析器需已启动）
+  // ========================
+  void begin(const char* topic = "vibration", uint32_t intervalMs = 10000) {
+    subTopic = String(topic);
+    reportIntervalMs = intervalMs;
+    lastReport = millis();
+    capture.setBlockHandler(analyzer.getFftSize(), [this](const int16_t* samples, size_t count, uint32_t) {
+      this->onBlock(samples, count);
+    });
+  }
+
+  // 每个窗口的特征（如异常检测）
+  void setFeatureHandler(FeatureHandler handler) {
+    featureHandler = handler;
+  }
+
+  // ========================
+  // 绑定异常检测器
+  // onlyOnAnomaly 为 true 时，正常状态下不发布周期报告，
+  // 只在进入 / 退出异常时立即发布告警，异常期间照常发布报告
+  // ========================
+  void setAnomalyDetector(AnomalyDetector* anomalyDetector, bool onlyOnAnomaly = true) {
+    detector = anomalyDetector;
+    reportOnlyOnAnomaly = onlyOnAnomaly;
+  }
+
+  // ========================
+  // 在 loop 中调用
+  // ========================
+  void loop() {
+    capture.poll();
+    if (windows > 0 && millis() - lastReport >= reportIntervalMs) {
+      if (detector && reportOnlyOnAnomaly && !detector->isAnomalous()) {
+        lastReport = millis();
+        resetAggregate();
+      } else {
+        publishReport();
+      }
+    }
+  }
+
+  // ========================
+  // 发布当前周期的聚合特征
+  // ========================
+  bool publishReport() {
+    if (windows == 0) return false;
+
+    SpectralFeatures report = latest;
+    report.rms = sqrtf(meanSquareSum / windows);
+    for (uint8_t i = 0; i < report.bandCount; i++) {
+      report.bandRms[i] = sqrtf(bandSquareSum[i] / windows);
+    }
+
+    PolicyJsonDocument doc(SpectralAnalyzer::payloadCapacity(report, 5));
+    SpectralAnalyzer::buildPayload(doc, report);
+    doc["n"] = windows;
+    doc["max"] = roundf(peakRms * 100) / 100;
+    doc["sr"] = capture.getSampleRate();
+    doc["ov"] = capture.getStats().overruns;
+    if (detector) {
+      doc["a"] = roundf(lastAnomaly.score * 100) / 100;
+    }
+
+    bool ok = false;
+    uint32_t bytes = measureJson(doc);
+    if (doc.overflowed()) {
+      Serial.println("✗ Vibration report truncated, not published");
+    } else {
+      ok = manager.publishJson(subTopic.c_str(), doc);
+    }
+    if (ok) {
+      publishedBytes += bytes;
+    }
+    lastReport = millis();
+    resetAggregate();
+    return ok;
+  }
+
+  // ========================
+  // 原始样本字节数 / 实际上行字节数
+  // ========================
+  float getReductionRatio() {
+    return publishedBytes > 0 ? (float)rawBytes / publishedBytes : 0;
+  }
+
+private:
+  void onBlock(const int16_t* samples, size_t count) {
+    SpectralFeatures f;
+    if (!analyzer.process(samples, count, f)) return;
+    rawBytes += count * sizeof(int16_t);
+
+    latest = f;
+    windows++;
+    meanSquareSum += f.rms * f.rms;
+    if (f.rms > peakRms) peakRms = f.rms;
+    for (uint8_t i = 0; i < f.bandCount; i++) {
+      bandSquareSum[i] += f.bandRms[i] * f.bandRms[i];
+    }
+
+    if (detector) {
+      lastAnomaly = detector->process(f);
+      if (lastAnomaly.changed) {
+        publishAlert(f);
+      }
+    }
+
+    if (featureHandler) {
+      featureHandler(f);
+    }
+  }
+
+  // ========================
+  // 异常状态变化告警（紧急，不进入发送窗口）
+  // ========================
+  void publishAlert(const SpectralFeatures& f) {
+    PolicyJsonDocument doc(SpectralAnalyzer::payloadCapacity(f, 5));
+    SpectralAnalyzer::buildPayload(doc, f);
+    doc["state"] = lastAnomaly.anomalous ? "anomaly" : "normal";
+    doc["a"] = roundf(lastAnomaly.score * 100) / 100;
+    doc["z"] = roundf(lastAnomaly.maxZ * 100) / 100;
+    doc["f"] = lastAnomaly.worstFeature;
+    doc["inf_us"] = lastAnomaly.inferenceUs;
+    if (doc.overflowed()) {
+      Serial.println("✗ Vibration alert truncated, not published");
+      return;
+    }
+
+    String topic = subTopic + "/alert";
+    if (manager.publishJson(topic.c_str(), doc, PRIORITY_URGENT)) {
+      publishedBytes += measureJson(doc);
+    }
+  }
+
+  void resetAggregate() {
+    windows = 0;
+    meanSquareSum = 0;
+    peakRms = 0;
+    memset(bandSquareSum, 0, sizeof(bandSquareSum));
+    memset(&latest, 0, sizeof(latest));
+  }
+};
+
+#endif
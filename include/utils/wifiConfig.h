@@ -31,6 +31,12 @@
 
 #include <vector>
 #include <map>
+#include <atomic>
+#include <mutex>
+
+#include "trace_scope.h"
+#include "string_intern.h"
+#include "boot_profiler.h"
 
 // ========================
 // 调试宏定义
@@ -51,7 +57,7 @@
 // 参数定义结构体
 // ========================
 struct ConfigParam {
-  String key;
+  InternedString key;             // 驻留字符串，按指针比较
   String label;
   String defaultValue;
   int maxLength;
@@ -63,7 +69,23 @@ struct ConfigParam {
 // 全局容器
 // ========================
 std::vector<ConfigParam> configParams;
-std::map<String, String> configValues;
+std::map<InternedString, String> configValues;
+
+// ========================
+// 配置访问保护
+// configParams / configValues 只在 configMutex 下访问（递归锁：setConfigValue 内会调用 saveConfig）；
+// StartupOrchestrator 在后台任务读取配置期间 configLoading 为 true，
+// 其他任务经 CONFIG_LOCK 的访问（getConfigValue 等）先等待读取完成，不会读到默认值
+// ========================
+std::recursive_mutex configMutex;
+std::atomic<bool> configLoading(false);
+
+inline std::recursive_mutex& configMutexAfterLoad() {
+  while (configLoading) delay(1);
+  return configMutex;
+}
+
+#define CONFIG_LOCK() std::lock_guard<std::recursive_mutex> configGuard(configMutexAfterLoad())
 
 #define CONFIG_FILE "/config.json"
 #define AUTO_START_AP true
@@ -93,6 +115,7 @@ String getConfigValue(const char* key);
 void setConfigValue(const char* key, const char* value);
 bool initFileSystem();
 bool initWiFiManager(const char* deviceName = "ESP-Device");
+bool runWiFiManager(const char* deviceName, bool startPortal);
 bool readConfig();
 bool saveConfig();
 void printAllParams();
@@ -105,6 +128,7 @@ void printSystemInfo();
 // 初始化芯片信息
 // ========================
 void initChipInfo() {
+  BOOT_PHASE("chip.info");
   chipInfo.chipType = CHIP_TYPE;
   
   #ifdef ESP8266
@@ -155,16 +179,18 @@ void printSystemInfo() {
 // 注册参数
 // ========================
 void registerParam(const char* key, const char* label, const char* defaultValue, int maxLength) {
+  CONFIG_LOCK();
   // 检查是否已存在
+  InternedString id(key);
   for (auto& param : configParams) {
-    if (param.key == key) {
+    if (param.key == id) {
       DEBUG_PRINTLN("Param already registered: " + String(key));
       return;
     }
   }
   
   ConfigParam newParam;
-  newParam.key = String(key);
+  newParam.key = id;
   newParam.label = String(label);
   newParam.defaultValue = String(defaultValue);
   newParam.maxLength = maxLength;
@@ -177,7 +203,7 @@ void registerParam(const char* key, const char* label, const char* defaultValue,
   );
   
   configParams.push_back(newParam);
-  configValues[String(key)] = String(defaultValue);
+  configValues[id] = String(defaultValue);
   
   DEBUG_PRINTLN("✓ Registered: " + String(key));
 }
@@ -186,13 +212,18 @@ void registerParam(const char* key, const char* label, const char* defaultValue,
 // 注销参数
 // ========================
 void unregisterParam(const char* key) {
+  CONFIG_LOCK();
+  InternedString id;
+  if (!InternedString::lookup(key, id)) {
+    return;
+  }
   for (auto it = configParams.begin(); it != configParams.end(); ++it) {
-    if (it->key == key) {
+    if (it->key == id) {
       if (it->wfmParam != nullptr) {
         delete it->wfmParam;
       }
       configParams.erase(it);
-      configValues.erase(String(key));
+      configValues.erase(id);
       DEBUG_PRINTLN("✗ Unregistered: " + String(key));
       return;
     }
@@ -203,6 +234,7 @@ void unregisterParam(const char* key) {
 // 清空所有参数
 // ========================
 void clearAllParams() {
+  CONFIG_LOCK();
   for (auto& param : configParams) {
     if (param.wfmParam != nullptr) {
       delete param.wfmParam;
@@ -217,8 +249,13 @@ void clearAllParams() {
 // 获取参数值
 // ========================
 String getConfigValue(const char* key) {
-  if (configValues.find(String(key)) != configValues.end()) {
-    return configValues[String(key)];
+  CONFIG_LOCK();
+  InternedString id;
+  if (InternedString::lookup(key, id)) {
+    auto it = configValues.find(id);
+    if (it != configValues.end()) {
+      return it->second;
+    }
   }
   DEBUG_PRINTLN("⚠ Config key not found: " + String(key));
   return "";
@@ -228,10 +265,13 @@ String getConfigValue(const char* key) {
 // 设置参数值
 // ========================
 void setConfigValue(const char* key, const char* value) {
+  CONFIG_LOCK();
+  InternedString id;
+  bool known = InternedString::lookup(key, id);
   for (auto& param : configParams) {
-    if (param.key == key) {
+    if (known && param.key == id) {
       param.value = String(value);
-      configValues[String(key)] = String(value);
+      configValues[id] = String(value);
       DEBUG_PRINTLN("✓ Set " + String(key) + " = " + String(value));
       saveConfig();
       return;
@@ -244,6 +284,7 @@ void setConfigValue(const char* key, const char* value) {
 // 初始化文件系统
 // ========================
 bool initFileSystem() {
+  BOOT_PHASE("fs.mount");
   #ifdef ESP8266
     if (!LittleFS.begin()) {
       DEBUG_PRINTLN("✗ Failed to mount LittleFS");
@@ -265,6 +306,10 @@ bool initFileSystem() {
 // 读取配置文件
 // ========================
 bool readConfig() {
+  TRACE_SCOPE("config.read", "config");
+  BOOT_PHASE("config.read");
+  // 读文件期间持锁，与 saveConfig 的截断重写互斥（读取方自身不等待 configLoading）
+  std::lock_guard<std::recursive_mutex> guard(configMutex);
   if (!FileSystem.exists(CONFIG_FILE)) {
     DEBUG_PRINTLN("⚠ Config file not found");
     return false;
@@ -302,6 +347,9 @@ bool readConfig() {
 // 保存配置文件
 // ========================
 bool saveConfig() {
+  TRACE_SCOPE("config.save", "config");
+  // 先加锁再以 "w" 打开：打开即截断文件，持锁期间 readConfig 不会读到空文件
+  CONFIG_LOCK();
   File file = FileSystem.open(CONFIG_FILE, "w");
   if (!file) {
     DEBUG_PRINTLN("✗ Failed to open config file for writing");
@@ -312,7 +360,7 @@ bool saveConfig() {
   
   // 保存所有参数
   for (auto& param : configParams) {
-    doc[param.key] = param.value;
+    doc[param.key.c_str()] = param.value;
   }
 
   serializeJson(doc, file);
@@ -326,6 +374,7 @@ bool saveConfig() {
 // 从 WiFiManager 加载配置
 // ========================
 void loadConfigFromWiFiManager() {
+  CONFIG_LOCK();
   bool changed = false;
   
   for (auto& param : configParams) {
@@ -357,23 +406,28 @@ bool initWiFiManager(const char* deviceName) {
     DEBUG_PRINTLN("Using default config values");
   }
   
-  // 更新 WiFiManager 参数的显示值
-  for (auto& param : configParams) {
-    if (param.wfmParam != nullptr) {
-      param.wfmParam->setValue(param.value.c_str(), param.maxLength);
-    }
-  }
-  
+  return runWiFiManager(deviceName, AUTO_START_AP);
+}
+
+// ========================
+// 运行 WiFiManager（配置门户或自动连接），要求配置已读取
+// ========================
+bool runWiFiManager(const char* deviceName, bool startPortal) {
   WiFiManager wifiManager;
   
   // 自定义 WiFiManager 样式（可选）
   wifiManager.setConfigPortalTimeout(180);
   wifiManager.setConnectTimeout(20);
   
-  // 添加所有参数到 WiFiManager
-  for (auto& param : configParams) {
-    if (param.wfmParam != nullptr) {
-      wifiManager.addParameter(param.wfmParam);
+  // 更新 WiFiManager 参数的显示值并添加到 WiFiManager；
+  // 门户运行期间不持有配置锁，WiFiManager 只访问各参数自己的 WiFiManagerParameter
+  {
+    CONFIG_LOCK();
+    for (auto& param : configParams) {
+      if (param.wfmParam != nullptr) {
+        param.wfmParam->setValue(param.value.c_str(), param.maxLength);
+        wifiManager.addParameter(param.wfmParam);
+      }
     }
   }
   
@@ -384,10 +438,12 @@ bool initWiFiManager(const char* deviceName) {
   
   bool connected = false;
   
-  if (AUTO_START_AP) {
+  if (startPortal) {
+    BOOT_PHASE("wifi.portal");
     DEBUG_PRINTLN("Starting config portal...");
     connected = wifiManager.startConfigPortal(deviceName);
   } else {
+    BOOT_PHASE("wifi.connect");
     DEBUG_PRINTLN("Attempting auto-connect...");
     connected = wifiManager.autoConnect(deviceName);
   }
@@ -421,6 +477,7 @@ void printAllParams() {
   Serial.println("║        Current Configuration              ║");
   Serial.println("╠════════════════════════════════════════════╣");
   
+  CONFIG_LOCK();
   for (auto& param : configParams) {
     String line = "║ " + param.label;
     // 填充空格
@@ -464,6 +521,7 @@ void resetConfig() {
   }
   
   // 重置所有参数为默认值
+  CONFIG_LOCK();
   for (auto& param : configParams) {
     param.value = param.defaultValue;
     configValues[param.key] = param.defaultValue;